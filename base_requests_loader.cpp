@@ -0,0 +1,341 @@
+#include "base_requests_loader.h"
+
+#include <algorithm>
+#include <future>
+#include <stdexcept>
+
+using namespace std::literals;
+
+BaseRequestsLoader::BaseRequestsLoader(TransportCatalogue& db) : db_(db) {}
+
+void BaseRequestsLoader::StartDict() {
+    CheckValue(ValueKind::DICT);
+    ++depth_;
+    if (depth_ == 2) {
+        BeginElement();
+    } else if (depth_ == 3 && field_ == ROAD_DISTANCES) {
+        section_ = ROAD_DISTANCES;
+    }
+}
+
+void BaseRequestsLoader::Key(std::string_view key) {
+    if (depth_ == 2) {
+        field_ = KeyField(key);
+        if (keys_ & field_) {
+            throw json::ParsingError("Duplicate key '"s + std::string(key) + "' have been found");
+        }
+        keys_ |= field_;
+    } else if (depth_ == 3 && section_ == ROAD_DISTANCES) {
+        distance_to_ = key;
+    }
+}
+
+void BaseRequestsLoader::EndDict() {
+    if (depth_ == 2) {
+        FinishElement();
+    } else if (depth_ == 3) {
+        section_ = 0;
+    }
+    --depth_;
+}
+
+void BaseRequestsLoader::StartArray() {
+    CheckValue(ValueKind::ARRAY);
+    ++depth_;
+    if (depth_ == 3 && field_ == STOPS) {
+        section_ = STOPS;
+    }
+}
+
+void BaseRequestsLoader::EndArray() {
+    if (depth_ == 1) {
+        complete_ = true;
+    } else if (depth_ == 3) {
+        section_ = 0;
+    }
+    --depth_;
+}
+
+void BaseRequestsLoader::String(std::string_view value) {
+    CheckValue(ValueKind::STRING);
+    if (depth_ == 2) {
+        if (field_ == TYPE) {
+            type_ = value;
+        } else if (field_ == NAME) {
+            name_ = value;
+        }
+    } else if (depth_ == 3 && section_ == STOPS) {
+        data_.bus_stops.push_back(data_.Store(value));
+    }
+}
+
+void BaseRequestsLoader::Int(int value) {
+    CheckValue(ValueKind::INT);
+    if (depth_ == 2) {
+        SetCoordinate(value);
+    } else if (depth_ == 3 && section_ == ROAD_DISTANCES) {
+        // Номер остановки станет известен в FinishElement
+        data_.distances.push_back({0, data_.Store(distance_to_), value});
+    }
+}
+
+void BaseRequestsLoader::Double(double value) {
+    CheckValue(ValueKind::DOUBLE);
+    if (depth_ == 2) {
+        SetCoordinate(value);
+    }
+}
+
+void BaseRequestsLoader::Bool(bool value) {
+    CheckValue(ValueKind::BOOL);
+    if (depth_ == 2 && field_ == IS_ROUNDTRIP) {
+        is_roundtrip_ = value;
+    }
+}
+
+void BaseRequestsLoader::Null() {
+    CheckValue(ValueKind::NULL_VALUE);
+}
+
+void BaseRequestsLoader::SetCoordinate(double value) {
+    if (field_ == LATITUDE) {
+        lat_ = value;
+    } else if (field_ == LONGITUDE) {
+        lng_ = value;
+    }
+}
+
+// Проверяет тип значения, которое начинается на текущей глубине: сам массив
+// base_requests, его элемент, поле элемента или элемент поля-контейнера
+void BaseRequestsLoader::CheckValue(ValueKind kind) {
+    if (depth_ == 0 && kind != ValueKind::ARRAY) {
+        throw std::logic_error("Node is not array");
+    }
+    if (depth_ == 1 && kind != ValueKind::DICT) {
+        throw std::logic_error("Node is not map");
+    }
+    if (depth_ == 2 && !IsFieldKind(field_, kind)) {
+        invalid_ |= field_;
+    }
+    if (depth_ == 3 && section_ != 0
+            && !(section_ == ROAD_DISTANCES ? kind == ValueKind::INT : kind == ValueKind::STRING)) {
+        invalid_items_ |= section_;
+    }
+}
+
+unsigned BaseRequestsLoader::KeyField(std::string_view key) {
+    if (key == "type"sv) return TYPE;
+    if (key == "name"sv) return NAME;
+    if (key == "latitude"sv) return LATITUDE;
+    if (key == "longitude"sv) return LONGITUDE;
+    if (key == "road_distances"sv) return ROAD_DISTANCES;
+    if (key == "stops"sv) return STOPS;
+    if (key == "is_roundtrip"sv) return IS_ROUNDTRIP;
+    return 0;
+}
+
+bool BaseRequestsLoader::IsFieldKind(unsigned field, ValueKind kind) {
+    switch (field) {
+        case TYPE:
+        case NAME:
+            return kind == ValueKind::STRING;
+        case LATITUDE:
+        case LONGITUDE:
+            return kind == ValueKind::INT || kind == ValueKind::DOUBLE;
+        case ROAD_DISTANCES:
+            return kind == ValueKind::DICT;
+        case STOPS:
+            return kind == ValueKind::ARRAY;
+        case IS_ROUNDTRIP:
+            return kind == ValueKind::BOOL;
+        default:
+            return true;
+    }
+}
+
+void BaseRequestsLoader::RequireFields(unsigned required, std::string_view type) const {
+    if ((keys_ & required) != required) {
+        throw std::out_of_range(std::string(type) + " request has no required field");
+    }
+    for (unsigned field = TYPE; field <= IS_ROUNDTRIP; field <<= 1) {
+        if (required & field) {
+            CheckFieldKind(field);
+        }
+    }
+}
+
+// Сообщения совпадают с исключениями Node::As... при разборе в дерево
+void BaseRequestsLoader::CheckFieldKind(unsigned field) const {
+    if (invalid_ & field) {
+        switch (field) {
+            case LATITUDE:
+            case LONGITUDE:
+                throw std::logic_error("Node is not double");
+            case ROAD_DISTANCES:
+                throw std::logic_error("Node is not map");
+            case STOPS:
+                throw std::logic_error("Node is not array");
+            case IS_ROUNDTRIP:
+                throw std::logic_error("Node is not bool");
+            default:
+                throw std::logic_error("Node is not string");
+        }
+    }
+    if (invalid_items_ & field) {
+        throw std::logic_error(field == ROAD_DISTANCES ? "Node is not int" : "Node is not string");
+    }
+}
+
+// Расстояния текущей остановки лежат в конце data_.distances
+void BaseRequestsLoader::CheckDistanceKeys() const {
+    const size_t count = data_.distances.size() - element_distances_;
+    if (count < 2) {
+        return;
+    }
+    std::vector<std::string_view> keys;
+    keys.reserve(count);
+    for (size_t i = element_distances_; i < data_.distances.size(); ++i) {
+        keys.push_back(data_.View(data_.distances[i].to));
+    }
+    std::sort(keys.begin(), keys.end());
+    if (auto it = std::adjacent_find(keys.begin(), keys.end()); it != keys.end()) {
+        throw json::ParsingError("Duplicate key '"s + std::string(*it) + "' have been found");
+    }
+}
+
+BaseRequestsLoader::StringRef BaseRequestsLoader::Buffers::Store(std::string_view str) {
+    StringRef ref{static_cast<uint32_t>(chars.size()), static_cast<uint32_t>(str.size())};
+    chars.append(str);
+    return ref;
+}
+
+std::string_view BaseRequestsLoader::Buffers::View(StringRef ref) const {
+    return std::string_view(chars).substr(ref.offset, ref.length);
+}
+
+void BaseRequestsLoader::BeginElement() {
+    field_ = section_ = 0;
+    type_.clear();
+    name_.clear();
+    lat_ = lng_ = 0.0;
+    is_roundtrip_ = false;
+    keys_ = invalid_ = invalid_items_ = 0;
+    element_chars_ = data_.chars.size();
+    element_distances_ = data_.distances.size();
+    element_stops_ = data_.bus_stops.size();
+}
+
+void BaseRequestsLoader::FinishElement() {
+    if (!(keys_ & TYPE)) {
+        throw std::out_of_range("Base request has no type");
+    }
+    CheckFieldKind(TYPE);
+    if (type_ == "Stop"sv) {
+        RequireFields(NAME | LATITUDE | LONGITUDE, type_);
+        CheckFieldKind(ROAD_DISTANCES);
+        CheckDistanceKeys();
+        data_.bus_stops.resize(element_stops_);
+        const uint32_t index = static_cast<uint32_t>(data_.stops.size());
+        data_.stops.push_back({data_.Store(name_), lat_, lng_});
+        for (size_t i = element_distances_; i < data_.distances.size(); ++i) {
+            data_.distances[i].from_index = index;
+        }
+        return;
+    }
+
+    // Элементы других типов не содержат расстояний
+    data_.distances.resize(element_distances_);
+    if (type_ == "Bus"sv) {
+        RequireFields(NAME | STOPS | IS_ROUNDTRIP, type_);
+        data_.buses.push_back({data_.Store(name_), static_cast<uint32_t>(element_stops_),
+                               static_cast<uint32_t>(data_.bus_stops.size()), is_roundtrip_});
+    } else {
+        data_.bus_stops.resize(element_stops_);
+        data_.chars.resize(element_chars_);
+    }
+}
+
+bool BaseRequestsLoader::LoadParallel(std::string_view array_text, unsigned threads) {
+    const auto elements = json::SplitArray(array_text);
+    if (!elements) {
+        return false;
+    }
+
+    // Делим элементы на участки с примерно равным объёмом текста
+    size_t total_size = 0;
+    for (std::string_view element : *elements) {
+        total_size += element.size();
+    }
+    const size_t part_count = std::max<size_t>(1, std::min<size_t>(threads, elements->size()));
+    std::vector<std::future<Buffers>> parts;
+    parts.reserve(part_count);
+    size_t begin = 0;
+    size_t accumulated = 0;
+    for (size_t part = 1; part <= part_count; ++part) {
+        size_t end = begin;
+        const size_t target = total_size * part / part_count;
+        while (end < elements->size() && (accumulated < target || part == part_count)) {
+            accumulated += (*elements)[end++].size();
+        }
+        parts.push_back(std::async(std::launch::async, [this, &elements, begin, end] {
+            BaseRequestsLoader loader(db_);
+            loader.StartArray();
+            for (size_t i = begin; i < end; ++i) {
+                json::Parse((*elements)[i], loader);
+            }
+            loader.EndArray();
+            return std::move(loader.data_);
+        }));
+        begin = end;
+    }
+    // Исключение из любого потока передаётся дальше после завершения остальных
+    for (auto& part : parts) {
+        parts_.push_back(part.get());
+    }
+    complete_ = true;
+    return true;
+}
+
+void BaseRequestsLoader::Finish() {
+    parts_.push_back(std::move(data_));
+    data_ = Buffers{};
+
+    // Остановки получают номера по порядку добавления, поэтому номер остановки
+    // в справочнике - это номер первой остановки участка плюс её номер в участке
+    std::vector<uint32_t> first_ids;
+    first_ids.reserve(parts_.size());
+    for (const Buffers& part : parts_) {
+        first_ids.push_back(static_cast<uint32_t>(db_.GetAllStops().size()));
+        Stop stop;
+        for (const PendingStop& pending : part.stops) {
+            stop.name = part.View(pending.name);
+            stop.lat = pending.lat;
+            stop.lng = pending.lng;
+            db_.AddStop(stop);
+        }
+    }
+
+    const auto& stops = db_.GetAllStops();
+    for (size_t i = 0; i < parts_.size(); ++i) {
+        for (const PendingDistance& pending : parts_[i].distances) {
+            if (const Stop* to = db_.FindStop(parts_[i].View(pending.to))) {
+                db_.SetDistance(&stops[first_ids[i] + pending.from_index], to, pending.distance);
+            }
+        }
+    }
+
+    Bus bus;
+    for (const Buffers& part : parts_) {
+        for (const PendingBus& pending : part.buses) {
+            bus.name = part.View(pending.name);
+            bus.stops.clear();
+            for (uint32_t i = pending.stops_begin; i < pending.stops_end; ++i) {
+                bus.stops.push_back(part.View(part.bus_stops[i]));
+            }
+            bus.is_roundtrip = pending.is_roundtrip;
+            db_.AddBus(bus);
+        }
+    }
+
+    std::vector<Buffers>{}.swap(parts_);
+}
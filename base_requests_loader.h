@@ -0,0 +1,138 @@
+#pragma once
+
+#include "json.h"
+#include "transport_catalogue.h"
+
+#include <cstdint>
+#include <string_view>
+#include <string>
+#include <vector>
+
+// Потоково загружает массив base_requests в справочник, не строя дерево Node.
+// Элементы копятся в компактных буферах и передаются в справочник в Finish:
+// сначала все остановки, затем расстояния и автобусы, которые могут ссылаться
+// на остановки, встретившиеся позже них. Как и разбор в дерево, загрузчик
+// отвергает повторяющиеся ключи, элементы без обязательных полей и значения
+// полей не того типа
+class BaseRequestsLoader final : public json::EventHandler {
+public:
+    explicit BaseRequestsLoader(TransportCatalogue& db);
+
+    void StartDict() override;
+    void Key(std::string_view key) override;
+    void EndDict() override;
+    void StartArray() override;
+    void EndArray() override;
+    void String(std::string_view value) override;
+    void Int(int value) override;
+    void Double(double value) override;
+    void Bool(bool value) override;
+    void Null() override;
+
+    // Массив base_requests полностью получен
+    bool IsComplete() const {
+        return complete_;
+    }
+
+    // Разбирает элементы массива base_requests, заданного текстом array_text, в threads
+    // потоках. Каждый поток заполняет собственные буферы, а Finish передаёт их в
+    // справочник в порядке следования элементов, поэтому результат не зависит от числа
+    // потоков. Возвращает false, если границы элементов найти не удалось; тогда массив
+    // нужно разобрать обычным образом
+    bool LoadParallel(std::string_view array_text, unsigned threads);
+
+    // Добавляет в справочник накопленные остановки, расстояния и автобусы
+    void Finish();
+
+private:
+    // Ссылка на строку в chars_
+    struct StringRef {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    struct PendingStop {
+        StringRef name;
+        double lat;
+        double lng;
+    };
+
+    struct PendingDistance {
+        // Номер остановки среди остановок тех же буферов
+        uint32_t from_index;
+        StringRef to;
+        int distance;
+    };
+
+    struct PendingBus {
+        StringRef name;
+        uint32_t stops_begin;
+        uint32_t stops_end;
+        bool is_roundtrip;
+    };
+
+    // Данные, накопленные при разборе последовательного участка base_requests
+    struct Buffers {
+        std::string chars;
+        std::vector<PendingStop> stops;
+        std::vector<PendingDistance> distances;
+        std::vector<StringRef> bus_stops;
+        std::vector<PendingBus> buses;
+
+        StringRef Store(std::string_view str);
+        std::string_view View(StringRef ref) const;
+    };
+
+    // Поля элемента base_requests; битовые флаги для keys_, invalid_ и invalid_items_
+    enum Field : unsigned {
+        TYPE = 1 << 0,
+        NAME = 1 << 1,
+        LATITUDE = 1 << 2,
+        LONGITUDE = 1 << 3,
+        ROAD_DISTANCES = 1 << 4,
+        STOPS = 1 << 5,
+        IS_ROUNDTRIP = 1 << 6,
+    };
+
+    enum class ValueKind { STRING, INT, DOUBLE, BOOL, NULL_VALUE, DICT, ARRAY };
+
+    void BeginElement();
+    void FinishElement();
+    void SetCoordinate(double value);
+    void CheckValue(ValueKind kind);
+    static unsigned KeyField(std::string_view key);
+    static bool IsFieldKind(unsigned field, ValueKind kind);
+    void RequireFields(unsigned required, std::string_view type) const;
+    void CheckFieldKind(unsigned field) const;
+    void CheckDistanceKeys() const;
+
+    TransportCatalogue& db_;
+    int depth_ = 0;
+    bool complete_ = false;
+    // Поле текущего элемента, значение которого разбирается, и поле-контейнер
+    // (ROAD_DISTANCES или STOPS), элементы которого разбираются
+    unsigned field_ = 0;
+    unsigned section_ = 0;
+
+    // Поля текущего элемента base_requests
+    std::string type_;
+    std::string name_;
+    double lat_ = 0.0;
+    double lng_ = 0.0;
+    bool is_roundtrip_ = false;
+    std::string distance_to_;
+    // Встреченные ключи известных полей, поля со значением не того типа и
+    // поля-контейнеры с элементами не того типа. Ошибка типа сообщается в
+    // FinishElement, только если поле нужно элементу его типа, как при разборе в дерево
+    unsigned keys_ = 0;
+    unsigned invalid_ = 0;
+    unsigned invalid_items_ = 0;
+    size_t element_chars_ = 0;
+    size_t element_distances_ = 0;
+    size_t element_stops_ = 0;
+
+    // Буферы, заполненные LoadParallel, в порядке следования участков
+    std::vector<Buffers> parts_;
+    // Буферы потокового разбора
+    Buffers data_;
+};
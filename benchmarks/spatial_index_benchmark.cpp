@@ -0,0 +1,85 @@
+// Замер скорости запросов к StopsSpatialIndex на 100 000 остановок: построение
+// индекса, поиск ближайших остановок и поиск в радиусе. Результат - среднее время
+// одного запроса в микросекундах; цель - меньше миллисекунды на запрос.
+//
+// Сборка из корня репозитория:
+//   g++ -std=c++17 -O2 -I. benchmarks/spatial_index_benchmark.cpp spatial_index.cpp transport_catalogue.cpp geo.cpp -o spatial_index_benchmark
+
+#include "spatial_index.h"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+constexpr int STOP_COUNT = 100'000;
+constexpr int QUERY_COUNT = 20'000;
+
+struct Area {
+    std::string_view name;
+    double min_lat;
+    double max_lat;
+    double min_lng;
+    double max_lng;
+};
+
+template <typename Query>
+void Measure(std::string_view name, const std::vector<geo::Coordinates>& centers, Query query) {
+    size_t found = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (const geo::Coordinates& center : centers) {
+        found += query(center).size();
+    }
+    const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "  " << name << ": " << elapsed.count() / centers.size() << " us/query, "
+              << static_cast<double>(found) / centers.size() << " stops/query" << '\n';
+}
+
+void Run(const Area& area) {
+    std::mt19937 random(42);
+    std::uniform_real_distribution<double> lat(area.min_lat, area.max_lat);
+    std::uniform_real_distribution<double> lng(area.min_lng, area.max_lng);
+
+    TransportCatalogue catalogue;
+    for (int i = 0; i < STOP_COUNT; ++i) {
+        Stop stop;
+        const std::string name = "Stop " + std::to_string(i);
+        stop.name = name;
+        stop.lat = lat(random);
+        stop.lng = lng(random);
+        catalogue.AddStop(stop);
+    }
+    catalogue.Freeze();
+
+    const auto build_start = std::chrono::steady_clock::now();
+    const StopsSpatialIndex index(catalogue);
+    const std::chrono::duration<double, std::milli> build = std::chrono::steady_clock::now() - build_start;
+    std::cout << area.name << ": " << STOP_COUNT << " stops, index built in " << build.count() << " ms" << '\n';
+
+    std::vector<geo::Coordinates> centers;
+    centers.reserve(QUERY_COUNT);
+    for (int i = 0; i < QUERY_COUNT; ++i) {
+        centers.push_back({lat(random), lng(random)});
+    }
+
+    Measure("FindNearest(1)", centers, [&index](geo::Coordinates center) {
+        return index.FindNearest(center, 1);
+    });
+    Measure("FindNearest(10)", centers, [&index](geo::Coordinates center) {
+        return index.FindNearest(center, 10);
+    });
+    Measure("FindWithinRadius(500 m)", centers, [&index](geo::Coordinates center) {
+        return index.FindWithinRadius(center, 500);
+    });
+}
+
+}  // namespace
+
+int main() {
+    Run({"city", 55.5, 55.9, 37.3, 37.9});
+    Run({"country", 41.0, 70.0, 27.0, 180.0});
+}
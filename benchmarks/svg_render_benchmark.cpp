@@ -0,0 +1,155 @@
+// Замер скорости вывода SVG: синтетический документ из 50 000 объектов (ломаные,
+// круги и подписи в пропорциях карты) выводится через svg::Document и
+// svg::StreamDocument, результат - байт в секунду. Объекты строятся один раз до
+// замеров, так что время включает только вывод.
+//
+// Сборка из корня репозитория:
+//   g++ -std=c++17 -O2 -I. benchmarks/svg_render_benchmark.cpp svg.cpp -o svg_render_benchmark
+
+#include "svg.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int OBJECT_COUNT = 50'000;
+constexpr int REPEAT_COUNT = 10;
+
+// Поток, который только считает байты и сбросы, - чтобы замерять вывод, а не рост
+// строки. Каждый сброс в настоящий файл или экранирующий поток - отдельная запись
+class CountingBuffer : public std::streambuf {
+public:
+    uint64_t GetSize() const {
+        return size_ + static_cast<uint64_t>(pptr() - pbase());
+    }
+
+    uint64_t GetSyncCount() const {
+        return sync_count_;
+    }
+
+protected:
+    int sync() override {
+        ++sync_count_;
+        return 0;
+    }
+
+    int_type overflow(int_type c) override {
+        size_ += static_cast<uint64_t>(pptr() - pbase());
+        setp(buffer_, buffer_ + sizeof(buffer_));
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            sputc(traits_type::to_char_type(c));
+        }
+        return traits_type::not_eof(c);
+    }
+
+private:
+    char buffer_[1 << 12];
+    uint64_t size_ = 0;
+    uint64_t sync_count_ = 0;
+};
+
+svg::Point RandomPoint(std::mt19937& random) {
+    std::uniform_real_distribution<double> coordinate(0.0, 1200.0);
+    return {coordinate(random), coordinate(random)};
+}
+
+template <typename Container>
+void AddObjects(Container& container) {
+    std::mt19937 random(42);
+    svg::Polyline polyline;
+    svg::Circle circle;
+    svg::Text text;
+    for (int i = 0; i < OBJECT_COUNT; ++i) {
+        switch (i % 5) {
+        case 0:
+            polyline.ClearPoints()
+                    .SetStrokeColor(svg::Rgb(255, 160, 0))
+                    .SetFillColor("none")
+                    .SetStrokeWidth(14)
+                    .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
+                    .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+            for (int j = 0; j < 10; ++j) {
+                polyline.AddPoint(RandomPoint(random));
+            }
+            container.Add(polyline);
+            break;
+        case 1:
+            circle.SetCenter(RandomPoint(random)).SetRadius(5).SetFillColor("white");
+            container.Add(circle);
+            break;
+        default:
+            text.SetPosition(RandomPoint(random))
+                .SetOffset({7, -3})
+                .SetFontSize(20)
+                .SetFontFamily("Verdana")
+                .SetData("Stop " + std::to_string(i))
+                .SetFillColor(svg::Rgba(255, 255, 255, 0.85))
+                .SetStrokeColor(svg::Rgba(255, 255, 255, 0.85))
+                .SetStrokeWidth(3);
+            container.Add(text);
+            break;
+        }
+    }
+}
+
+// Готовые объекты для StreamDocument, который сам их не хранит
+class ObjectList : public svg::ObjectContainer {
+public:
+    void AddPtr(std::unique_ptr<svg::Object>&& obj) override {
+        objects_.push_back(std::move(obj));
+    }
+
+    const std::vector<std::unique_ptr<svg::Object>>& GetObjects() const {
+        return objects_;
+    }
+
+private:
+    std::vector<std::unique_ptr<svg::Object>> objects_;
+};
+
+template <typename Render>
+void Measure(std::string_view name, Render render) {
+    uint64_t bytes = 0;
+    uint64_t sync_count = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < REPEAT_COUNT; ++i) {
+        CountingBuffer buffer;
+        std::ostream out(&buffer);
+        render(out);
+        bytes += buffer.GetSize();
+        sync_count += buffer.GetSyncCount();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << name << ": " << bytes / REPEAT_COUNT << " bytes, "
+              << elapsed.count() / REPEAT_COUNT * 1000 << " ms, "
+              << bytes / elapsed.count() / (1 << 20) << " MiB/s, "
+              << sync_count / REPEAT_COUNT << " flushes" << '\n';
+}
+
+}  // namespace
+
+int main() {
+    svg::Document document;
+    AddObjects(document);
+    Measure("Document::Render", [&document](std::ostream& out) {
+        document.Render(out);
+    });
+
+    ObjectList objects;
+    AddObjects(objects);
+    Measure("StreamDocument", [&objects](std::ostream& out) {
+        NumberFormatter numbers;
+        svg::StreamDocument document(out, numbers);
+        for (const auto& object : objects.GetObjects()) {
+            document.Add(*object);
+        }
+        document.Finish();
+    });
+}
@@ -1,21 +1,26 @@
 #pragma once
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <unordered_set>
-#include <unordered_map>
 #include <optional>
 
+// Имена остановок и автобусов ссылаются на строки, принадлежащие справочнику
+// (при добавлении в справочник они переносятся в его пул строк)
 struct Stop {
-    std::string name;
+    std::string_view name;
     double lat = 0.0;
     double lng = 0.0;
-    // Дорожные расстояния до других остановок
-    std::unordered_map<std::string, int> road_distances;
+    // Заполняются справочником: порядковый номер остановки и диапазон
+    // [distances_begin, distances_end) в его массиве дорожных расстояний
+    uint32_t id = 0;
+    uint32_t distances_begin = 0;
+    uint32_t distances_end = 0;
 };
 
 struct Bus {
-    std::string name;
-    std::vector<std::string> stops;
+    std::string_view name;
+    std::vector<std::string_view> stops;
     bool is_roundtrip = false;
 };
 
@@ -1,11 +1,70 @@
 #define _USE_MATH_DEFINES
 #include "geo.h"
 
+#include <algorithm>
 #include <cmath>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace geo {
 
-const double EARTH_RADIUS = 6371000; 
+namespace {
+
+const double DEG_TO_RAD = M_PI / 180.0;
+
+struct UnitVector {
+    double x;
+    double y;
+    double z;
+};
+
+UnitVector ToUnitVector(Coordinates coords) {
+    const double lat = coords.lat * DEG_TO_RAD;
+    const double lng = coords.lng * DEG_TO_RAD;
+    return {std::cos(lat) * std::cos(lng), std::cos(lat) * std::sin(lng), std::sin(lat)};
+}
+
+// Пакетные ядра записывают в out промежуточную величину: для теоремы косинусов -
+// скалярное произведение векторов, для гаверсинуса - квадрат длины хорды.
+// FinishDistances затем переводит её в метры
+void FinishDistances(double* out, size_t count, DistanceFormula formula) {
+    if (formula == DistanceFormula::SPHERICAL_COSINES) {
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = std::acos(std::clamp(out[i], -1.0, 1.0)) * EARTH_RADIUS;
+        }
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = 2.0 * std::asin(std::min(std::sqrt(out[i]) * 0.5, 1.0)) * EARTH_RADIUS;
+        }
+    }
+}
+
+double Combine(double ax, double ay, double az, double bx, double by, double bz, DistanceFormula formula) {
+    if (formula == DistanceFormula::SPHERICAL_COSINES) {
+        return ax * bx + ay * by + az * bz;
+    }
+    const double dx = ax - bx;
+    const double dy = ay - by;
+    const double dz = az - bz;
+    return dx * dx + dy * dy + dz * dz;
+}
+
+#ifdef __SSE2__
+__m128d Combine(__m128d ax, __m128d ay, __m128d az, __m128d bx, __m128d by, __m128d bz,
+                DistanceFormula formula) {
+    if (formula == DistanceFormula::SPHERICAL_COSINES) {
+        return _mm_add_pd(_mm_add_pd(_mm_mul_pd(ax, bx), _mm_mul_pd(ay, by)), _mm_mul_pd(az, bz));
+    }
+    const __m128d dx = _mm_sub_pd(ax, bx);
+    const __m128d dy = _mm_sub_pd(ay, by);
+    const __m128d dz = _mm_sub_pd(az, bz);
+    return _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_mul_pd(dz, dz));
+}
+#endif
+
+}  // namespace
 
 double ComputeDistance(Coordinates from, Coordinates to) {
     using namespace std;
@@ -15,4 +74,82 @@ double ComputeDistance(Coordinates from, Coordinates to) {
         * EARTH_RADIUS;
 }
 
-}  // namespace geo
\ No newline at end of file
+double ComputeHaversineDistance(Coordinates from, Coordinates to) {
+    using namespace std;
+    const double sin_dlat = sin((to.lat - from.lat) * DEG_TO_RAD / 2.0);
+    const double sin_dlng = sin((to.lng - from.lng) * DEG_TO_RAD / 2.0);
+    const double a = sin_dlat * sin_dlat
+        + cos(from.lat * DEG_TO_RAD) * cos(to.lat * DEG_TO_RAD) * sin_dlng * sin_dlng;
+    return 2.0 * asin(min(sqrt(a), 1.0)) * EARTH_RADIUS;
+}
+
+void PrecomputedPoints::Reserve(size_t count) {
+    x_.reserve(count);
+    y_.reserve(count);
+    z_.reserve(count);
+}
+
+size_t PrecomputedPoints::Add(Coordinates coords) {
+    const UnitVector v = ToUnitVector(coords);
+    x_.push_back(v.x);
+    y_.push_back(v.y);
+    z_.push_back(v.z);
+    return x_.size() - 1;
+}
+
+double PrecomputedPoints::Distance(size_t from, size_t to, DistanceFormula formula) const {
+    double value = Combine(x_[from], y_[from], z_[from], x_[to], y_[to], z_[to], formula);
+    FinishDistances(&value, 1, formula);
+    return value;
+}
+
+void PrecomputedPoints::ComputePathDistances(const uint32_t* ids, size_t count, double* out,
+                                             DistanceFormula formula) const {
+    if (count < 2) {
+        return;
+    }
+    const size_t hops = count - 1;
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 2 <= hops; i += 2) {
+        const uint32_t a0 = ids[i], a1 = ids[i + 1], b1 = ids[i + 2];
+        // _mm_set_pd принимает элементы от старшего к младшему
+        const __m128d ax = _mm_set_pd(x_[a1], x_[a0]);
+        const __m128d ay = _mm_set_pd(y_[a1], y_[a0]);
+        const __m128d az = _mm_set_pd(z_[a1], z_[a0]);
+        const __m128d bx = _mm_set_pd(x_[b1], x_[a1]);
+        const __m128d by = _mm_set_pd(y_[b1], y_[a1]);
+        const __m128d bz = _mm_set_pd(z_[b1], z_[a1]);
+        _mm_storeu_pd(out + i, Combine(ax, ay, az, bx, by, bz, formula));
+    }
+#endif
+    for (; i < hops; ++i) {
+        const uint32_t a = ids[i], b = ids[i + 1];
+        out[i] = Combine(x_[a], y_[a], z_[a], x_[b], y_[b], z_[b], formula);
+    }
+    FinishDistances(out, hops, formula);
+}
+
+void PrecomputedPoints::ComputeDistancesFrom(Coordinates center, size_t first, size_t count, double* out,
+                                             DistanceFormula formula) const {
+    const UnitVector c = ToUnitVector(center);
+    const double* xs = x_.data() + first;
+    const double* ys = y_.data() + first;
+    const double* zs = z_.data() + first;
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128d cx = _mm_set1_pd(c.x);
+    const __m128d cy = _mm_set1_pd(c.y);
+    const __m128d cz = _mm_set1_pd(c.z);
+    for (; i + 2 <= count; i += 2) {
+        _mm_storeu_pd(out + i, Combine(cx, cy, cz, _mm_loadu_pd(xs + i), _mm_loadu_pd(ys + i),
+                                       _mm_loadu_pd(zs + i), formula));
+    }
+#endif
+    for (; i < count; ++i) {
+        out[i] = Combine(c.x, c.y, c.z, xs[i], ys[i], zs[i], formula);
+    }
+    FinishDistances(out, count, formula);
+}
+
+}  // namespace geo
@@ -1,12 +1,56 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
 namespace geo {
 
+inline constexpr double EARTH_RADIUS = 6371000;
+
 struct Coordinates {
     double lat; // Широта
     double lng; // Долгота
 };
 
+enum class DistanceFormula {
+    // Сферическая теорема косинусов, как в ComputeDistance. Для близких точек acos
+    // теряет точность
+    SPHERICAL_COSINES,
+    // Через длину хорды (эквивалент гаверсинуса): устойчива на малых расстояниях
+    HAVERSINE,
+};
+
 double ComputeDistance(Coordinates from, Coordinates to);
+double ComputeHaversineDistance(Coordinates from, Coordinates to);
+
+// Набор точек с заранее вычисленной тригонометрией, хранящийся по столбцам (SoA):
+// для каждой точки - единичный вектор на сфере. Расстояние между точками сводится
+// к скалярному произведению векторов и одной обратной тригонометрической функции,
+// а пакетные методы считают произведения по две пары за раз (SSE2)
+class PrecomputedPoints {
+public:
+    void Reserve(size_t count);
+    size_t Add(Coordinates coords);
+    size_t Size() const {
+        return x_.size();
+    }
+
+    double Distance(size_t from, size_t to,
+                    DistanceFormula formula = DistanceFormula::SPHERICAL_COSINES) const;
+
+    // out[i] - расстояние между точками ids[i] и ids[i + 1]; out вмещает count - 1 значений
+    void ComputePathDistances(const uint32_t* ids, size_t count, double* out,
+                              DistanceFormula formula = DistanceFormula::SPHERICAL_COSINES) const;
+
+    // out[i] - расстояние от center до точки first + i
+    void ComputeDistancesFrom(Coordinates center, size_t first, size_t count, double* out,
+                              DistanceFormula formula = DistanceFormula::SPHERICAL_COSINES) const;
+
+private:
+    std::vector<double> x_;
+    std::vector<double> y_;
+    std::vector<double> z_;
+};
 
-}  // namespace geo
\ No newline at end of file
+}  // namespace geo
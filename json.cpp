@@ -1,231 +1,479 @@
 #include "json.h"
+#include "json_scan.h"
 
+#include <charconv>
 #include <iterator>
+#include <sstream>
+#include <string_view>
 
 namespace json {
 
+struct Document::Contents {
+    // Монотонная арена: массивы и словари документа занимают несколько больших блоков.
+    // Объявлена до root, чтобы пережить его при разрушении
+    std::pmr::monotonic_buffer_resource nodes;
+    Node root;
+};
+
 namespace {
 using namespace std::literals;
 
-Node LoadNode(std::istream& input);
-Node LoadString(std::istream& input);
+// Разбирает JSON из непрерывного буфера, перемещая указатель по символам.
+// ParseNode строит дерево Node, ParseEvents сообщает о тех же элементах обработчику.
+// Ошибки сообщаются исключением ParsingError, на корректном входе исключения не возникают
+class Parser {
+public:
+    // Массивы и словари, построенные ParseNode, размещаются в resource
+    Parser(const char* begin, const char* end,
+           std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : pos_(begin)
+        , end_(end)
+        , resource_(resource)
+        , scanner_(detail::GetTextScanner()) {
+    }
 
-std::string LoadLiteral(std::istream& input) {
-    std::string s;
-    while (std::isalpha(input.peek())) {
-        s.push_back(static_cast<char>(input.get()));
+    Node ParseNode() {
+        if (!SkipWhitespace()) {
+            throw ParsingError("Unexpected EOF"s);
+        }
+        switch (*pos_) {
+            case '[':
+                ++pos_;
+                return ParseArray();
+            case '{':
+                ++pos_;
+                return ParseDict();
+            case '"':
+                ++pos_;
+                return Node(std::string(ParseString()));
+            case 't':
+                [[fallthrough]];
+            case 'f':
+                return Node(ParseBool());
+            case 'n':
+                ParseNull();
+                return Node{nullptr};
+            default:
+                return std::visit([](auto value) { return Node(value); }, ParseNumber());
+        }
     }
-    return s;
-}
 
-Node LoadArray(std::istream& input) {
-    std::vector<Node> result;
+    void ParseEvents(EventHandler& handler) {
+        if (!SkipWhitespace()) {
+            throw ParsingError("Unexpected EOF"s);
+        }
+        switch (*pos_) {
+            case '[':
+                ++pos_;
+                handler.StartArray();
+                while (SkipWhitespace() && *pos_ != ']') {
+                    if (*pos_ == ',') {
+                        ++pos_;
+                    }
+                    ParseEvents(handler);
+                }
+                if (pos_ == end_) {
+                    throw ParsingError("Array parsing error"s);
+                }
+                ++pos_;
+                handler.EndArray();
+                break;
+            case '{':
+                ++pos_;
+                handler.StartDict();
+                while (SkipWhitespace() && *pos_ != '}') {
+                    if (ParseDictSeparator()) {
+                        handler.Key(ParseKey());
+                        ParseEvents(handler);
+                    }
+                }
+                if (pos_ == end_) {
+                    throw ParsingError("Dictionary parsing error"s);
+                }
+                ++pos_;
+                handler.EndDict();
+                break;
+            case '"':
+                ++pos_;
+                handler.String(ParseString());
+                break;
+            case 't':
+                [[fallthrough]];
+            case 'f':
+                handler.Bool(ParseBool());
+                break;
+            case 'n':
+                ParseNull();
+                handler.Null();
+                break;
+            default:
+                if (const auto number = ParseNumber(); std::holds_alternative<int>(number)) {
+                    handler.Int(std::get<int>(number));
+                } else {
+                    handler.Double(std::get<double>(number));
+                }
+        }
+    }
+
+private:
+    static bool IsSpace(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+    }
+
+    static bool IsDigit(char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    static bool IsAlpha(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    }
 
-    for (char c; input >> c && c != ']';) {
-        if (c != ',') {
-            input.putback(c);
+    // Пропускает пробельные символы; возвращает false, если достигнут конец буфера.
+    // Чаще всего пробелов нет вовсе, это проверяется без вызова сканера
+    bool SkipWhitespace() {
+        if (pos_ != end_ && IsSpace(*pos_)) {
+            pos_ = scanner_.skip_whitespace(pos_ + 1, end_);
         }
-        result.push_back(LoadNode(input));
+        return pos_ != end_;
     }
-    if (!input) {
-        throw ParsingError("Array parsing error"s);
+
+    std::string_view ParseLiteral() {
+        const char* begin = pos_;
+        while (pos_ != end_ && IsAlpha(*pos_)) {
+            ++pos_;
+        }
+        return {begin, static_cast<size_t>(pos_ - begin)};
     }
-    return Node(std::move(result));
-}
 
-Node LoadDict(std::istream& input) {
-    Dict dict;
+    Node ParseArray() {
+        Array result(resource_);
+        while (SkipWhitespace() && *pos_ != ']') {
+            if (*pos_ == ',') {
+                ++pos_;
+            }
+            result.push_back(ParseNode());
+        }
+        if (pos_ == end_) {
+            throw ParsingError("Array parsing error"s);
+        }
+        ++pos_;
+        return Node(std::move(result));
+    }
 
-    for (char c; input >> c && c != '}';) {
+    // Разбирает очередной символ внутри словаря. Возвращает true, если начался
+    // ключ (открывающая кавычка уже пропущена), false для разделителя ','
+    bool ParseDictSeparator() {
+        const char c = *pos_++;
         if (c == '"') {
-            std::string key = LoadString(input).AsString();
-            if (input >> c && c == ':') {
-                if (dict.find(key) != dict.end()) {
-                    throw ParsingError("Duplicate key '"s + key + "' have been found");
-                }
-                dict.emplace(std::move(key), LoadNode(input));
-            } else {
-                throw ParsingError(": is expected but '"s + c + "' has been found"s);
-            }
+            return true;
         } else if (c != ',') {
             throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
         }
+        return false;
     }
-    if (!input) {
-        throw ParsingError("Dictionary parsing error"s);
+
+    // Разбирает ключ вместе с последующим ':'
+    std::string_view ParseKey() {
+        const std::string_view key = ParseString();
+        if (SkipWhitespace() && *pos_ == ':') {
+            ++pos_;
+            return key;
+        } else if (pos_ == end_) {
+            throw ParsingError("Dictionary parsing error"s);
+        }
+        throw ParsingError(": is expected but '"s + *pos_ + "' has been found"s);
     }
-    return Node(std::move(dict));
-}
 
-Node LoadString(std::istream& input) {
-    auto it = std::istreambuf_iterator<char>(input);
-    auto end = std::istreambuf_iterator<char>();
-    std::string s;
-    while (true) {
-        if (it == end) {
-            throw ParsingError("String parsing error");
+    Node ParseDict() {
+        Dict dict(resource_);
+        while (SkipWhitespace() && *pos_ != '}') {
+            if (ParseDictSeparator()) {
+                std::string key(ParseKey());
+                dict.AppendUnsorted(std::move(key), ParseNode());
+            }
+        }
+        if (pos_ == end_) {
+            throw ParsingError("Dictionary parsing error"s);
+        }
+        ++pos_;
+        if (const auto duplicate = dict.SortKeys()) {
+            throw ParsingError("Duplicate key '"s + *duplicate + "' have been found");
         }
-        const char ch = *it;
-        if (ch == '"') {
-            ++it;
-            break;
-        } else if (ch == '\\') {
-            ++it;
-            if (it == end) {
+        return Node(std::move(dict));
+    }
+
+    // Вызывается после открывающей кавычки. Строка без escape-последовательностей
+    // возвращается как ссылка на исходный буфер, иначе собирается в scratch_;
+    // в обоих случаях результат действителен до следующего вызова
+    std::string_view ParseString() {
+        const char* begin = pos_;
+        pos_ = scanner_.find_string_special(pos_, end_);
+        if (pos_ != end_ && *pos_ == '"') {
+            return {begin, static_cast<size_t>(pos_++ - begin)};
+        }
+
+        scratch_.assign(begin, pos_);
+        while (true) {
+            // Копируем участок без спецсимволов целиком
+            const char* run = pos_;
+            pos_ = scanner_.find_string_special(pos_, end_);
+            scratch_.append(run, pos_);
+            if (pos_ == end_) {
                 throw ParsingError("String parsing error");
             }
-            const char escaped_char = *(it);
-            switch (escaped_char) {
-                case 'n':
-                    s.push_back('\n');
-                    break;
-                case 't':
-                    s.push_back('\t');
-                    break;
-                case 'r':
-                    s.push_back('\r');
-                    break;
-                case '"':
-                    s.push_back('"');
-                    break;
-                case '\\':
-                    s.push_back('\\');
-                    break;
-                default:
-                    throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
+            const char ch = *pos_++;
+            if (ch == '"') {
+                break;
+            } else if (ch == '\\') {
+                if (pos_ == end_) {
+                    throw ParsingError("String parsing error");
+                }
+                const char escaped_char = *pos_++;
+                switch (escaped_char) {
+                    case 'n':
+                        scratch_.push_back('\n');
+                        break;
+                    case 't':
+                        scratch_.push_back('\t');
+                        break;
+                    case 'r':
+                        scratch_.push_back('\r');
+                        break;
+                    case '"':
+                        scratch_.push_back('"');
+                        break;
+                    case '\\':
+                        scratch_.push_back('\\');
+                        break;
+                    default:
+                        throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
+                }
+            } else {
+                throw ParsingError("Unexpected end of line"s);
             }
-        } else if (ch == '\n' || ch == '\r') {
-            throw ParsingError("Unexpected end of line"s);
-        } else {
-            s.push_back(ch);
         }
-        ++it;
+        return scratch_;
     }
 
-    return Node(std::move(s));
-}
+    bool ParseBool() {
+        const std::string_view s = ParseLiteral();
+        if (s == "true"sv) {
+            return true;
+        } else if (s == "false"sv) {
+            return false;
+        } else {
+            throw ParsingError("Failed to parse '"s + std::string(s) + "' as bool"s);
+        }
+    }
 
-Node LoadBool(std::istream& input) {
-    const auto s = LoadLiteral(input);
-    if (s == "true"sv) {
-        return Node{true};
-    } else if (s == "false"sv) {
-        return Node{false};
-    } else {
-        throw ParsingError("Failed to parse '"s + s + "' as bool"s);
+    void ParseNull() {
+        if (const std::string_view literal = ParseLiteral(); literal != "null"sv) {
+            throw ParsingError("Failed to parse '"s + std::string(literal) + "' as null"s);
+        }
     }
-}
 
-Node LoadNull(std::istream& input) {
-    if (auto literal = LoadLiteral(input); literal == "null"sv) {
-        return Node{nullptr};
-    } else {
-        throw ParsingError("Failed to parse '"s + literal + "' as null"s);
+    void ReadDigits() {
+        if (pos_ == end_ || !IsDigit(*pos_)) {
+            throw ParsingError("A digit is expected"s);
+        }
+        while (pos_ != end_ && IsDigit(*pos_)) {
+            ++pos_;
+        }
     }
-}
 
-Node LoadNumber(std::istream& input) {
-    std::string parsed_num;
+    std::variant<int, double> ParseNumber() {
+        const char* begin = pos_;
+        if (*pos_ == '-') {
+            ++pos_;
+        }
+        // Парсим целую часть числа; после 0 в JSON не могут идти другие цифры
+        if (pos_ != end_ && *pos_ == '0') {
+            ++pos_;
+        } else {
+            ReadDigits();
+        }
 
-    // Считывает в parsed_num очередной символ из input
-    auto read_char = [&parsed_num, &input] {
-        parsed_num += static_cast<char>(input.get());
-        if (!input) {
-            throw ParsingError("Failed to read number from stream"s);
+        bool is_int = true;
+        // Парсим дробную часть числа
+        if (pos_ != end_ && *pos_ == '.') {
+            ++pos_;
+            ReadDigits();
+            is_int = false;
         }
-    };
 
-    // Считывает одну или более цифр в parsed_num из input
-    auto read_digits = [&input, read_char] {
-        if (!std::isdigit(input.peek())) {
-            throw ParsingError("A digit is expected"s);
+        // Парсим экспоненциальную часть числа
+        if (pos_ != end_ && (*pos_ == 'e' || *pos_ == 'E')) {
+            ++pos_;
+            if (pos_ != end_ && (*pos_ == '+' || *pos_ == '-')) {
+                ++pos_;
+            }
+            ReadDigits();
+            is_int = false;
+        }
+
+        if (is_int) {
+            // При переполнении int число будет разобрано как double
+            int value = 0;
+            if (auto [ptr, ec] = std::from_chars(begin, pos_, value); ec == std::errc{} && ptr == pos_) {
+                return value;
+            }
         }
-        while (std::isdigit(input.peek())) {
-            read_char();
+        double value = 0.0;
+        if (auto [ptr, ec] = std::from_chars(begin, pos_, value); ec == std::errc{} && ptr == pos_) {
+            return value;
         }
-    };
+        throw ParsingError("Failed to convert "s + std::string(begin, pos_) + " to number"s);
+    }
+
+    const char* pos_;
+    const char* end_;
+    std::pmr::memory_resource* resource_;
+    const detail::TextScanner& scanner_;
+    std::string scratch_;
+};
 
-    if (input.peek() == '-') {
-        read_char();
+// Находит границы значений в тексте, проверяя только парность скобок и кавычек
+class StructureScanner {
+public:
+    explicit StructureScanner(std::string_view text)
+        : pos_(text.data())
+        , end_(text.data() + text.size())
+        , scanner_(detail::GetTextScanner()) {
     }
-    // Парсим целую часть числа
-    if (input.peek() == '0') {
-        read_char();
-        // После 0 в JSON не могут идти другие цифры
-    } else {
-        read_digits();
+
+    // Пропускает пробельные символы и символ c, если он следует за ними
+    bool Expect(char c) {
+        SkipWhitespace();
+        if (pos_ != end_ && *pos_ == c) {
+            ++pos_;
+            return true;
+        }
+        return false;
     }
 
-    bool is_int = true;
-    // Парсим дробную часть числа
-    if (input.peek() == '.') {
-        read_char();
-        read_digits();
-        is_int = false;
+    bool AtEnd() {
+        SkipWhitespace();
+        return pos_ == end_;
     }
 
-    // Парсим экспоненциальную часть числа
-    if (int ch = input.peek(); ch == 'e' || ch == 'E') {
-        read_char();
-        if (ch = input.peek(); ch == '+' || ch == '-') {
-            read_char();
+    // Ключ без кавычек; nullopt, если ключ содержит escape-последовательность
+    std::optional<std::string_view> SkipKey() {
+        if (!Expect('"')) {
+            return std::nullopt;
+        }
+        const char* begin = pos_;
+        pos_ = scanner_.find_string_special(pos_, end_);
+        if (pos_ == end_ || *pos_ != '"') {
+            return std::nullopt;
         }
-        read_digits();
-        is_int = false;
+        return std::string_view(begin, static_cast<size_t>(pos_++ - begin));
     }
 
-    try {
-        if (is_int) {
-            // Сначала пробуем преобразовать строку в int
-            try {
-                return std::stoi(parsed_num);
-            } catch (...) {
-                // В случае неудачи, например, при переполнении
-                // код ниже попробует преобразовать строку в double
+    std::optional<std::string_view> SkipValue() {
+        SkipWhitespace();
+        const char* begin = pos_;
+        if (pos_ == end_) {
+            return std::nullopt;
+        }
+        bool ok = true;
+        if (*pos_ == '"') {
+            ++pos_;
+            ok = SkipString();
+        } else if (*pos_ == '[' || *pos_ == '{') {
+            ok = SkipContainer();
+        } else {
+            // Число или литерал продолжаются до разделителя
+            while (pos_ != end_ && !IsDelimiter(*pos_)) {
+                ++pos_;
             }
+            ok = pos_ != begin;
+        }
+        if (!ok) {
+            return std::nullopt;
         }
-        return std::stod(parsed_num);
-    } catch (...) {
-        throw ParsingError("Failed to convert "s + parsed_num + " to number"s);
-    }
-}
-
-Node LoadNode(std::istream& input) {
-    char c;
-    if (!(input >> c)) {
-        throw ParsingError("Unexpected EOF"s);
-    }
-    switch (c) {
-        case '[':
-            return LoadArray(input);
-        case '{':
-            return LoadDict(input);
-        case '"':
-            return LoadString(input);
-        case 't':
-            // Атрибут [[fallthrough]] (провалиться) ничего не делает, и является
-            // подсказкой компилятору и человеку, что здесь программист явно задумывал
-            // разрешить переход к инструкции следующей ветки case, а не случайно забыл
-            // написать break, return или throw.
-            // В данном случае, встретив t или f, переходим к попытке парсинга
-            // литералов true либо false
-            [[fallthrough]];
-        case 'f':
-            input.putback(c);
-            return LoadBool(input);
-        case 'n':
-            input.putback(c);
-            return LoadNull(input);
-        default:
-            input.putback(c);
-            return LoadNumber(input);
+        return std::string_view(begin, static_cast<size_t>(pos_ - begin));
+    }
+
+private:
+    static bool IsDelimiter(char c) {
+        return c == ',' || c == ':' || c == ']' || c == '}' || c == ' ' || c == '\n' || c == '\r'
+            || c == '\t' || c == '\v' || c == '\f';
+    }
+
+    static bool IsStructural(char c) {
+        return c == '"' || c == '[' || c == ']' || c == '{' || c == '}';
+    }
+
+    void SkipWhitespace() {
+        pos_ = scanner_.skip_whitespace(pos_, end_);
     }
-}
+
+    // Вызывается после открывающей кавычки
+    bool SkipString() {
+        while (true) {
+            pos_ = scanner_.find_string_special(pos_, end_);
+            if (pos_ == end_) {
+                return false;
+            }
+            const char c = *pos_++;
+            if (c == '"') {
+                return true;
+            }
+            if (c != '\\' || pos_ == end_) {
+                return false;
+            }
+            ++pos_;
+        }
+    }
+
+    bool SkipContainer() {
+        closing_.clear();
+        do {
+            switch (const char c = *pos_++) {
+                case '"':
+                    if (!SkipString()) {
+                        return false;
+                    }
+                    break;
+                case '[':
+                    closing_.push_back(']');
+                    break;
+                case '{':
+                    closing_.push_back('}');
+                    break;
+                case ']':
+                    [[fallthrough]];
+                case '}':
+                    if (closing_.back() != c) {
+                        return false;
+                    }
+                    closing_.pop_back();
+                    break;
+                default:
+                    // Числа, литералы, пробелы и разделители на вложенность не влияют
+                    while (pos_ != end_ && !IsStructural(*pos_)) {
+                        ++pos_;
+                    }
+            }
+        } while (!closing_.empty() && pos_ != end_);
+        return closing_.empty();
+    }
+
+    const char* pos_;
+    const char* end_;
+    const detail::TextScanner& scanner_;
+    // Ожидаемые закрывающие скобки открытых контейнеров
+    std::string closing_;
+};
 
 struct PrintContext {
     std::ostream& out;
+    // Общий буфер для форматирования всех чисел документа
+    NumberFormatter& numbers;
     int indent_step = 4;
     int indent = 0;
+    // Без переводов строк и отступов
+    bool compact = false;
 
     void PrintIndent() const {
         for (int i = 0; i < indent; ++i) {
@@ -233,8 +481,14 @@ struct PrintContext {
         }
     }
 
+    void PrintLineBreak() const {
+        if (!compact) {
+            out.put('\n');
+        }
+    }
+
     PrintContext Indented() const {
-        return {out, indent_step, indent_step + indent};
+        return {out, numbers, indent_step, indent_step + indent, compact};
     }
 };
 
@@ -245,33 +499,55 @@ void PrintValue(const Value& value, const PrintContext& ctx) {
     ctx.out << value;
 }
 
-void PrintString(const std::string& value, std::ostream& out) {
-    out.put('"');
-    for (const char c : value) {
-        switch (c) {
+// Выводит value с экранированием, но без кавычек. Участки без спецсимволов
+// записываются целиком
+void PrintEscaped(std::string_view value, std::ostream& out) {
+    size_t run_begin = 0;
+    for (size_t i = 0; i < value.size(); ++i) {
+        std::string_view escaped;
+        switch (value[i]) {
             case '\r':
-                out << "\\r"sv;
+                escaped = "\\r"sv;
                 break;
             case '\n':
-                out << "\\n"sv;
+                escaped = "\\n"sv;
                 break;
             case '\t':
-                out << "\\t"sv;
+                escaped = "\\t"sv;
                 break;
+            // Символы " и \ выводятся как \" или \\, соответственно
             case '"':
-                // Символы " и \ выводятся как \" или \\, соответственно
-                [[fallthrough]];
+                escaped = "\\\""sv;
+                break;
             case '\\':
-                out.put('\\');
-                [[fallthrough]];
-            default:
-                out.put(c);
+                escaped = "\\\\"sv;
                 break;
+            default:
+                continue;
         }
+        out.write(value.data() + run_begin, static_cast<std::streamsize>(i - run_begin));
+        out.write(escaped.data(), static_cast<std::streamsize>(escaped.size()));
+        run_begin = i + 1;
     }
+    out.write(value.data() + run_begin, static_cast<std::streamsize>(value.size() - run_begin));
+}
+
+void PrintString(std::string_view value, std::ostream& out) {
+    out.put('"');
+    PrintEscaped(value, out);
     out.put('"');
 }
 
+template <>
+void PrintValue<int>(const int& value, const PrintContext& ctx) {
+    ctx.numbers.Write(ctx.out, value);
+}
+
+template <>
+void PrintValue<double>(const double& value, const PrintContext& ctx) {
+    ctx.numbers.Write(ctx.out, value);
+}
+
 template <>
 void PrintValue<std::string>(const std::string& value, const PrintContext& ctx) {
     PrintString(value, ctx.out);
@@ -294,19 +570,21 @@ void PrintValue<bool>(const bool& value, const PrintContext& ctx) {
 template <>
 void PrintValue<Array>(const Array& nodes, const PrintContext& ctx) {
     std::ostream& out = ctx.out;
-    out << "[\n"sv;
+    out.put('[');
+    ctx.PrintLineBreak();
     bool first = true;
     auto inner_ctx = ctx.Indented();
     for (const Node& node : nodes) {
         if (first) {
             first = false;
         } else {
-            out << ",\n"sv;
+            out.put(',');
+            ctx.PrintLineBreak();
         }
         inner_ctx.PrintIndent();
         PrintNode(node, inner_ctx);
     }
-    out.put('\n');
+    ctx.PrintLineBreak();
     ctx.PrintIndent();
     out.put(']');
 }
@@ -314,21 +592,23 @@ void PrintValue<Array>(const Array& nodes, const PrintContext& ctx) {
 template <>
 void PrintValue<Dict>(const Dict& nodes, const PrintContext& ctx) {
     std::ostream& out = ctx.out;
-    out << "{\n"sv;
+    out.put('{');
+    ctx.PrintLineBreak();
     bool first = true;
     auto inner_ctx = ctx.Indented();
     for (const auto& [key, node] : nodes) {
         if (first) {
             first = false;
         } else {
-            out << ",\n"sv;
+            out.put(',');
+            ctx.PrintLineBreak();
         }
         inner_ctx.PrintIndent();
         PrintString(key, ctx.out);
-        out << ": "sv;
+        out << (ctx.compact ? ":"sv : ": "sv);
         PrintNode(node, inner_ctx);
     }
-    out.put('\n');
+    ctx.PrintLineBreak();
     ctx.PrintIndent();
     out.put('}');
 }
@@ -341,14 +621,444 @@ void PrintNode(const Node& node, const PrintContext& ctx) {
         node.GetValue());
 }
 
+// Сообщает обработчику об элементах готового дерева
+void EmitNode(const Node& node, EventHandler& handler) {
+    if (node.IsArray()) {
+        handler.StartArray();
+        for (const Node& item : node.AsArray()) {
+            EmitNode(item, handler);
+        }
+        handler.EndArray();
+    } else if (node.IsMap()) {
+        handler.StartDict();
+        for (const auto& [key, item] : node.AsMap()) {
+            handler.Key(key);
+            EmitNode(item, handler);
+        }
+        handler.EndDict();
+    } else if (node.IsString()) {
+        handler.String(node.AsStringView());
+    } else if (node.IsInt()) {
+        handler.Int(node.AsInt());
+    } else if (node.IsPureDouble()) {
+        handler.Double(node.AsDouble());
+    } else if (node.IsBool()) {
+        handler.Bool(node.AsBool());
+    } else {
+        handler.Null();
+    }
+}
+
 }  // namespace
 
+std::string ReadAll(std::istream& input) {
+    std::string buffer;
+    char chunk[64 * 1024];
+    while (input.read(chunk, sizeof(chunk)) || input.gcount() > 0) {
+        buffer.append(chunk, static_cast<size_t>(input.gcount()));
+    }
+    return buffer;
+}
+
 Document Load(std::istream& input) {
-    return Document{LoadNode(input)};
+    const std::string buffer = ReadAll(input);
+    return Load(std::string_view(buffer));
 }
 
-void Print(const Document& doc, std::ostream& output) {
-    PrintNode(doc.GetRoot(), PrintContext{output});
+Document Load(std::string_view text) {
+    auto contents = std::make_shared<Document::Contents>();
+    Parser parser(text.data(), text.data() + text.size(), &contents->nodes);
+    contents->root = parser.ParseNode();
+    return Document(std::shared_ptr<const Document::Contents>(std::move(contents)));
+}
+
+void Parse(std::string_view text, EventHandler& handler) {
+    Parser parser(text.data(), text.data() + text.size());
+    parser.ParseEvents(handler);
+}
+
+std::optional<std::vector<std::string_view>> SplitArray(std::string_view text) {
+    StructureScanner scanner(text);
+    std::vector<std::string_view> elements;
+    if (!scanner.Expect('[')) {
+        return std::nullopt;
+    }
+    if (!scanner.Expect(']')) {
+        do {
+            const auto element = scanner.SkipValue();
+            if (!element) {
+                return std::nullopt;
+            }
+            elements.push_back(*element);
+        } while (scanner.Expect(','));
+        if (!scanner.Expect(']')) {
+            return std::nullopt;
+        }
+    }
+    if (!scanner.AtEnd()) {
+        return std::nullopt;
+    }
+    return elements;
+}
+
+std::optional<std::vector<Member>> SplitDict(std::string_view text) {
+    StructureScanner scanner(text);
+    std::vector<Member> members;
+    if (!scanner.Expect('{')) {
+        return std::nullopt;
+    }
+    if (!scanner.Expect('}')) {
+        do {
+            const auto key = scanner.SkipKey();
+            if (!key || !scanner.Expect(':')) {
+                return std::nullopt;
+            }
+            const auto value = scanner.SkipValue();
+            if (!value) {
+                return std::nullopt;
+            }
+            members.push_back({*key, *value});
+        } while (scanner.Expect(','));
+        if (!scanner.Expect('}')) {
+            return std::nullopt;
+        }
+    }
+    if (!scanner.AtEnd()) {
+        return std::nullopt;
+    }
+    return members;
+}
+
+void TreeBuilder::StartDict() {
+    frames_.emplace_back(Dict(resource_));
+}
+
+void TreeBuilder::Key(std::string_view key) {
+    keys_.emplace_back(key);
+}
+
+void TreeBuilder::EndDict() {
+    auto& dict = std::get<Dict>(frames_.back());
+    if (const auto duplicate = dict.SortKeys()) {
+        throw ParsingError("Duplicate key '"s + *duplicate + "' have been found");
+    }
+    Node node(std::move(dict));
+    frames_.pop_back();
+    AddValue(std::move(node));
+}
+
+void TreeBuilder::StartArray() {
+    frames_.emplace_back(Array(resource_));
+}
+
+void TreeBuilder::EndArray() {
+    Node node(std::move(std::get<Array>(frames_.back())));
+    frames_.pop_back();
+    AddValue(std::move(node));
+}
+
+void TreeBuilder::String(std::string_view value) {
+    AddValue(Node(std::string(value)));
+}
+
+void TreeBuilder::Int(int value) {
+    AddValue(Node(value));
+}
+
+void TreeBuilder::Double(double value) {
+    AddValue(Node(value));
+}
+
+void TreeBuilder::Bool(bool value) {
+    AddValue(Node(value));
+}
+
+void TreeBuilder::Null() {
+    AddValue(Node(nullptr));
+}
+
+Node TreeBuilder::Extract() {
+    Node result = std::move(*result_);
+    result_.reset();
+    return result;
+}
+
+void TreeBuilder::AddValue(Node node) {
+    if (frames_.empty()) {
+        result_ = std::move(node);
+    } else if (auto* array = std::get_if<Array>(&frames_.back())) {
+        array->push_back(std::move(node));
+    } else {
+        // Ключи упорядочиваются и проверяются на повторы в EndDict
+        std::get<Dict>(frames_.back()).AppendUnsorted(std::move(keys_.back()), std::move(node));
+        keys_.pop_back();
+    }
+}
+
+void Print(const Document& doc, std::ostream& output, OutputFormat format) {
+    NumberFormatter numbers;
+    const bool compact = format == OutputFormat::COMPACT;
+    PrintNode(doc.GetRoot(), PrintContext{output, numbers, compact ? 0 : 4, 0, compact});
+}
+
+Writer::Writer(std::ostream& output, OutputFormat format, int level, NumberFormatter numbers)
+    : output_(&output)
+    , compact_(format == OutputFormat::COMPACT)
+    , level_(level)
+    , numbers_(numbers) {
+    frames_.reserve(8);
+}
+
+Writer::Writer(EventHandler& sink)
+    : sink_(&sink) {
+    frames_.reserve(8);
+}
+
+Writer& Writer::StartDict() {
+    BeforeValue("StartDict");
+    if (sink_) {
+        sink_->StartDict();
+    } else {
+        output_->put('{');
+        WriteLineBreak();
+    }
+    frames_.push_back({true});
+    return *this;
+}
+
+Writer& Writer::Key(std::string_view key) {
+    if (completed_) throw std::logic_error("Key after value already set");
+    if (frames_.empty() || !frames_.back().is_dict) throw std::logic_error("Key outside of dict");
+    if (waiting_value_) throw std::logic_error("Key after Key");
+    if (sink_) {
+        sink_->Key(key);
+    } else {
+        if (!frames_.back().empty) {
+            output_->put(',');
+            WriteLineBreak();
+        }
+        WriteIndent();
+        PrintString(key, *output_);
+        *output_ << (compact_ ? ":"sv : ": "sv);
+    }
+    frames_.back().empty = false;
+    waiting_value_ = true;
+    return *this;
+}
+
+Writer& Writer::EndDict() {
+    Close(true);
+    return *this;
+}
+
+Writer& Writer::StartArray() {
+    BeforeValue("StartArray");
+    if (sink_) {
+        sink_->StartArray();
+    } else {
+        output_->put('[');
+        WriteLineBreak();
+    }
+    frames_.push_back({false});
+    return *this;
+}
+
+Writer& Writer::EndArray() {
+    Close(false);
+    return *this;
+}
+
+Writer& Writer::Value(std::string_view value) {
+    BeforeValue("Value");
+    if (sink_) {
+        sink_->String(value);
+    } else {
+        PrintString(value, *output_);
+    }
+    AfterValue();
+    return *this;
+}
+
+Writer& Writer::Value(const char* value) {
+    return Value(std::string_view(value));
+}
+
+Writer& Writer::Value(const std::string& value) {
+    return Value(std::string_view(value));
+}
+
+Writer& Writer::Value(int value) {
+    BeforeValue("Value");
+    if (sink_) {
+        sink_->Int(value);
+    } else {
+        numbers_.Write(*output_, value);
+    }
+    AfterValue();
+    return *this;
+}
+
+Writer& Writer::Value(double value) {
+    BeforeValue("Value");
+    if (sink_) {
+        sink_->Double(value);
+    } else {
+        numbers_.Write(*output_, value);
+    }
+    AfterValue();
+    return *this;
+}
+
+Writer& Writer::Value(bool value) {
+    BeforeValue("Value");
+    if (sink_) {
+        sink_->Bool(value);
+    } else {
+        *output_ << (value ? "true"sv : "false"sv);
+    }
+    AfterValue();
+    return *this;
+}
+
+Writer& Writer::Value(std::nullptr_t) {
+    BeforeValue("Value");
+    if (sink_) {
+        sink_->Null();
+    } else {
+        *output_ << "null"sv;
+    }
+    AfterValue();
+    return *this;
+}
+
+Writer& Writer::StreamValue(const std::function<void(std::ostream&)>& write) {
+    BeforeValue("Value");
+    if (sink_) {
+        std::ostringstream text;
+        write(text);
+        sink_->String(text.str());
+    } else {
+        output_->put('"');
+        EscapingStreamBuf buffer(*output_);
+        std::ostream escaped(&buffer);
+        write(escaped);
+        escaped.flush();
+        output_->put('"');
+    }
+    AfterValue();
+    return *this;
+}
+
+Writer& Writer::Value(const Node& node) {
+    BeforeValue("Value");
+    if (sink_) {
+        EmitNode(node, *sink_);
+    } else {
+        PrintNode(node, PrintContext{*output_, numbers_, compact_ ? 0 : 4, Indent(), compact_});
+    }
+    AfterValue();
+    return *this;
+}
+
+EscapingStreamBuf::EscapingStreamBuf(std::ostream& out)
+    : out_(out) {
+    setp(buffer_, buffer_ + sizeof(buffer_));
+}
+
+EscapingStreamBuf::~EscapingStreamBuf() {
+    FlushBuffer();
+}
+
+EscapingStreamBuf::int_type EscapingStreamBuf::overflow(int_type c) {
+    FlushBuffer();
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int EscapingStreamBuf::sync() {
+    FlushBuffer();
+    return out_ ? 0 : -1;
+}
+
+void EscapingStreamBuf::FlushBuffer() {
+    PrintEscaped({pbase(), static_cast<size_t>(pptr() - pbase())}, out_);
+    setp(buffer_, buffer_ + sizeof(buffer_));
+}
+
+void Writer::BeforeValue(const char* operation) {
+    if (completed_) {
+        throw std::logic_error(operation + " after value already set"s);
+    }
+    if (frames_.empty()) {
+        return;
+    }
+    Frame& frame = frames_.back();
+    if (frame.is_dict) {
+        if (!waiting_value_) {
+            throw std::logic_error(operation + " in wrong context"s);
+        }
+        waiting_value_ = false;
+        return;
+    }
+    if (!sink_) {
+        if (!frame.empty) {
+            output_->put(',');
+            WriteLineBreak();
+        }
+        WriteIndent();
+    }
+    frame.empty = false;
+}
+
+void Writer::AfterValue() {
+    if (frames_.empty()) {
+        completed_ = true;
+    }
+}
+
+void Writer::Close(bool is_dict) {
+    const char* operation = is_dict ? "EndDict" : "EndArray";
+    if (completed_) {
+        throw std::logic_error(operation + " after value already set"s);
+    }
+    if (frames_.empty() || frames_.back().is_dict != is_dict) {
+        throw std::logic_error(operation + (is_dict ? " outside of dict"s : " outside of array"s));
+    }
+    if (waiting_value_) {
+        throw std::logic_error("EndDict after Key");
+    }
+    frames_.pop_back();
+    if (sink_) {
+        if (is_dict) {
+            sink_->EndDict();
+        } else {
+            sink_->EndArray();
+        }
+    } else {
+        WriteLineBreak();
+        WriteIndent();
+        output_->put(is_dict ? '}' : ']');
+    }
+    AfterValue();
+}
+
+int Writer::Indent() const {
+    return compact_ ? 0 : (level_ + static_cast<int>(frames_.size())) * 4;
+}
+
+void Writer::WriteLineBreak() {
+    if (!compact_) {
+        output_->put('\n');
+    }
+}
+
+void Writer::WriteIndent() {
+    for (int i = Indent(); i > 0; --i) {
+        output_->put(' ');
+    }
 }
 
 }  // namespace json
@@ -428,6 +1138,13 @@ const std::string& Node::AsString() const {
     throw std::logic_error("Node is not string");
 }
 
+std::string_view Node::AsStringView() const {
+    if (std::holds_alternative<std::string>(value_)) {
+        return std::get<std::string>(value_);
+    }
+    throw std::logic_error("Node is not string");
+}
+
 const Array& Node::AsArray() const {
     if (std::holds_alternative<Array>(value_)) {
         return std::get<Array>(value_);
@@ -461,14 +1178,22 @@ bool Node::operator==(const Dict& rhs) const {
 }
 
 // Реализации методов Document
-Document::Document(Node root) : root_(std::move(root)) {}
+Document::Document(Node root) {
+    auto contents = std::make_shared<Contents>();
+    contents->root = std::move(root);
+    contents_ = std::move(contents);
+}
+
+Document::Document(std::shared_ptr<const Contents> contents)
+    : contents_(std::move(contents)) {
+}
 
 const Node& Document::GetRoot() const {
-    return root_;
+    return contents_->root;
 }
 
 bool Document::operator==(const Document& rhs) const {
-    return root_ == rhs.root_;
+    return GetRoot() == rhs.GetRoot();
 }
 
 bool Document::operator!=(const Document& rhs) const {
@@ -1,16 +1,75 @@
 #pragma once
 
+#include "number_format.h"
+
 #include <iostream>
-#include <map>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
 namespace json {
 
 class Node;
-using Dict = std::map<std::string, Node>;
-using Array = std::vector<Node>;
+// Массивы и словари могут размещаться в арене (std::pmr::memory_resource);
+// по умолчанию используется обычная динамическая память
+using Array = std::pmr::vector<Node>;
+
+// Словарь на отсортированном по ключу векторе. Ключи перечисляются в порядке
+// возрастания, как у std::map, но элементы лежат в одном непрерывном блоке
+class Dict {
+public:
+    using value_type = std::pair<std::string, Node>;
+    using Storage = std::pmr::vector<value_type>;
+    using iterator = Storage::iterator;
+    using const_iterator = Storage::const_iterator;
+
+    Dict() = default;
+    explicit Dict(std::pmr::memory_resource* resource)
+        : items_(resource) {
+    }
+
+    iterator begin() { return items_.begin(); }
+    iterator end() { return items_.end(); }
+    const_iterator begin() const { return items_.begin(); }
+    const_iterator end() const { return items_.end(); }
+    size_t size() const { return items_.size(); }
+    bool empty() const { return items_.empty(); }
+
+    iterator find(std::string_view key);
+    const_iterator find(std::string_view key) const;
+    size_t count(std::string_view key) const;
+    // Бросает std::out_of_range, если ключа нет
+    const Node& at(std::string_view key) const;
+
+    // Как и std::map::emplace, не заменяет значение существующего ключа.
+    // Вставка в середину вектора линейна, поэтому словари из многих ключей
+    // собираются через AppendUnsorted и SortKeys
+    template <typename Key, typename Value>
+    std::pair<iterator, bool> emplace(Key&& key, Value&& value);
+
+    // Добавляет элемент в конец, не поддерживая порядок ключей. Пока после таких
+    // вставок не вызван SortKeys, поиск по словарю не работает
+    value_type& AppendUnsorted(std::string key, Node value);
+    // Упорядочивает элементы по ключу за O(n log n). Из элементов с одинаковым ключом
+    // остаётся первый добавленный, как при emplace; возвращает повторявшийся ключ
+    std::optional<std::string> SortKeys();
+
+    bool operator==(const Dict& rhs) const;
+    bool operator!=(const Dict& rhs) const;
+
+private:
+    iterator LowerBound(std::string_view key);
+    const_iterator LowerBound(std::string_view key) const;
+
+    Storage items_;
+};
 
 class ParsingError : public std::runtime_error {
 public:
@@ -48,6 +107,7 @@ public:
     bool AsBool() const;
     double AsDouble() const;
     const std::string& AsString() const;
+    std::string_view AsStringView() const;
     const Array& AsArray() const;
     const Dict& AsMap() const;
 
@@ -64,6 +124,79 @@ private:
     Value value_;
 };
 
+inline Dict::iterator Dict::LowerBound(std::string_view key) {
+    return std::lower_bound(items_.begin(), items_.end(), key,
+        [](const value_type& item, std::string_view k) { return item.first < k; });
+}
+
+inline Dict::const_iterator Dict::LowerBound(std::string_view key) const {
+    return std::lower_bound(items_.begin(), items_.end(), key,
+        [](const value_type& item, std::string_view k) { return item.first < k; });
+}
+
+inline Dict::iterator Dict::find(std::string_view key) {
+    auto it = LowerBound(key);
+    return it != items_.end() && it->first == key ? it : items_.end();
+}
+
+inline Dict::const_iterator Dict::find(std::string_view key) const {
+    auto it = LowerBound(key);
+    return it != items_.end() && it->first == key ? it : items_.end();
+}
+
+inline size_t Dict::count(std::string_view key) const {
+    return find(key) != items_.end() ? 1 : 0;
+}
+
+inline const Node& Dict::at(std::string_view key) const {
+    if (auto it = find(key); it != items_.end()) {
+        return it->second;
+    }
+    throw std::out_of_range("Dict::at");
+}
+
+template <typename Key, typename Value>
+std::pair<Dict::iterator, bool> Dict::emplace(Key&& key, Value&& value) {
+    auto it = LowerBound(key);
+    if (it != items_.end() && it->first == std::string_view(key)) {
+        return {it, false};
+    }
+    it = items_.emplace(it, std::string(std::forward<Key>(key)), Node(std::forward<Value>(value)));
+    return {it, true};
+}
+
+inline Dict::value_type& Dict::AppendUnsorted(std::string key, Node value) {
+    return items_.emplace_back(std::move(key), std::move(value));
+}
+
+inline std::optional<std::string> Dict::SortKeys() {
+    auto less = [](const value_type& lhs, const value_type& rhs) {
+        return lhs.first < rhs.first;
+    };
+    auto equal = [](const value_type& lhs, const value_type& rhs) {
+        return lhs.first == rhs.first;
+    };
+    // Ключи во входных документах часто уже упорядочены
+    if (!std::is_sorted(items_.begin(), items_.end(), less)) {
+        std::stable_sort(items_.begin(), items_.end(), less);
+    }
+    auto it = std::adjacent_find(items_.begin(), items_.end(), equal);
+    if (it == items_.end()) {
+        return std::nullopt;
+    }
+    std::optional<std::string> duplicate = it->first;
+    items_.erase(std::unique(it, items_.end(), equal), items_.end());
+    return duplicate;
+}
+
+inline bool Dict::operator==(const Dict& rhs) const {
+    return items_ == rhs.items_;
+}
+
+inline bool Dict::operator!=(const Dict& rhs) const {
+    return !(*this == rhs);
+}
+
 class Document {
 public:
     explicit Document(Node root);
@@ -73,12 +206,187 @@ public:
     bool operator!=(const Document& rhs) const;
 
 private:
-    Node root_;
+    friend Document Load(std::string_view text);
+
+    // Корень вместе с ареной, в которой размещены его массивы и словари. Копии
+    // документа разделяют их целиком, поэтому при присваивании арена не может
+    // освободиться раньше узлов
+    struct Contents;
+
+    explicit Document(std::shared_ptr<const Contents> contents);
+
+    std::shared_ptr<const Contents> contents_;
 };
 
+// Считывает поток до конца и разбирает его содержимое как один документ
 Document Load(std::istream& input);
-void Print(const Document& doc, std::ostream& output);
+// Массивы и словари документа размещаются в принадлежащей ему арене
+Document Load(std::string_view text);
+
+// Считывает поток до конца в одну строку
+std::string ReadAll(std::istream& input);
+
+// Получатель событий потокового разбора. Строки и ключи передаются как
+// string_view, действительные только на время вызова
+class EventHandler {
+public:
+    virtual void StartDict() = 0;
+    virtual void Key(std::string_view key) = 0;
+    virtual void EndDict() = 0;
+    virtual void StartArray() = 0;
+    virtual void EndArray() = 0;
+    virtual void String(std::string_view value) = 0;
+    virtual void Int(int value) = 0;
+    virtual void Double(double value) = 0;
+    virtual void Bool(bool value) = 0;
+    virtual void Null() = 0;
+
+protected:
+    ~EventHandler() = default;
+};
+
+// Разбирает одно значение из text, сообщая о его элементах обработчику
+void Parse(std::string_view text, EventHandler& handler);
+
+// Быстрый структурный просмотр: находит границы значений, не разбирая их.
+// Правильность самих значений не проверяется; если структура не распознана
+// (или ключ содержит escape-последовательность), возвращается nullopt, и текст
+// следует разобрать обычным образом, чтобы получить сообщение об ошибке
+
+struct Member {
+    std::string_view key;
+    std::string_view value;
+};
+
+// Элементы массива, которым является text
+std::optional<std::vector<std::string_view>> SplitArray(std::string_view text);
+// Пары "ключ - значение" словаря, которым является text, в порядке следования
+std::optional<std::vector<Member>> SplitDict(std::string_view text);
+
+// Собирает Node из потока событий. Позволяет сохранить в виде дерева
+// отдельные части документа, разбираемого потоково
+class TreeBuilder final : public EventHandler {
+public:
+    // Массивы и словари дерева размещаются в resource, который должен пережить их
+    explicit TreeBuilder(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : resource_(resource) {
+    }
+
+    void StartDict() override;
+    void Key(std::string_view key) override;
+    void EndDict() override;
+    void StartArray() override;
+    void EndArray() override;
+    void String(std::string_view value) override;
+    void Int(int value) override;
+    void Double(double value) override;
+    void Bool(bool value) override;
+    void Null() override;
+
+    // Значение верхнего уровня полностью получено
+    bool IsComplete() const {
+        return result_.has_value();
+    }
+    Node Extract();
+
+private:
+    void AddValue(Node node);
+
+    std::pmr::memory_resource* resource_;
+    std::vector<std::variant<Array, Dict>> frames_;
+    std::vector<std::string> keys_;
+    std::optional<Node> result_;
+};
+enum class OutputFormat {
+    // С переводами строк и отступом в четыре пробела
+    PRETTY,
+    // Без пробельных символов между элементами
+    COMPACT,
+};
+
+void Print(const Document& doc, std::ostream& output, OutputFormat format = OutputFormat::PRETTY);
 
+// Буфер потока, который экранирует записанный текст как содержимое строки JSON
+// (без кавычек) и передаёт результат в out. Текст копится в небольшом буфере и
+// экранируется при его заполнении, при flush и при уничтожении
+class EscapingStreamBuf : public std::streambuf {
+public:
+    explicit EscapingStreamBuf(std::ostream& out);
+    ~EscapingStreamBuf() override;
+
+protected:
+    int_type overflow(int_type c) override;
+    int sync() override;
+
+private:
+    void FlushBuffer();
+
+    std::ostream& out_;
+    char buffer_[4096];
+};
+
+// Записывает JSON по мере вызовов, не строя дерево Node. Порядок вызовов проверяется
+// так же, как в Builder: нарушение приводит к std::logic_error.
+// Первый конструктор печатает в output так же, как Print с тем же format, как если бы
+// значение стояло на уровне вложенности level; числа форматируются numbers. Ключи
+// словарей выводятся в порядке вызовов Key, поэтому для совпадения с Print их нужно
+// передавать по возрастанию.
+// Второй конструктор передаёт проверенные события обработчику sink
+class Writer {
+public:
+    explicit Writer(std::ostream& output, OutputFormat format = OutputFormat::PRETTY, int level = 0,
+                    NumberFormatter numbers = NumberFormatter{});
+    explicit Writer(EventHandler& sink);
+
+    Writer& StartDict();
+    Writer& Key(std::string_view key);
+    Writer& EndDict();
+    Writer& StartArray();
+    Writer& EndArray();
+    Writer& Value(std::string_view value);
+    Writer& Value(const char* value);
+    Writer& Value(const std::string& value);
+    Writer& Value(int value);
+    Writer& Value(double value);
+    Writer& Value(bool value);
+    Writer& Value(std::nullptr_t);
+    Writer& Value(const Node& node);
+    // Строковое значение, текст которого write выводит в переданный поток. При записи
+    // в std::ostream текст экранируется по пути в вывод, не собираясь в памяти целиком
+    Writer& StreamValue(const std::function<void(std::ostream&)>& write);
+
+    // Значение верхнего уровня записано полностью
+    bool IsComplete() const {
+        return completed_;
+    }
+
+    // Форматтер чисел, которым можно выводить числа в том же стиле вне JSON
+    NumberFormatter& GetNumberFormatter() {
+        return numbers_;
+    }
+
+private:
+    struct Frame {
+        bool is_dict;
+        bool empty = true;
+    };
+
+    void BeforeValue(const char* operation);
+    void AfterValue();
+    void Close(bool is_dict);
+    int Indent() const;
+    void WriteIndent();
+    void WriteLineBreak();
+
+    std::ostream* output_ = nullptr;
+    EventHandler* sink_ = nullptr;
+    bool compact_ = false;
+    int level_ = 0;
+    NumberFormatter numbers_;
+    std::vector<Frame> frames_;
+    bool waiting_value_ = false;
+    bool completed_ = false;
+};
 
 Node MakeNode(int value);
 Node MakeNode(double value);
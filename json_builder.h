@@ -109,7 +109,7 @@ inline Builder::Builder() = default;
 
 inline DictItemContext Builder::StartDict() {
     if (completed_) throw std::logic_error("StartDict after Build or after value already set");
-    Node dict_node = Dict{};
+    Node dict_node{Dict{}};
     if (nodes_stack_.empty()) {
         root_ = std::move(dict_node);
         nodes_stack_.push_back(&root_);
@@ -124,9 +124,7 @@ inline DictItemContext Builder::StartDict() {
     }
     if (waiting_key_) {
         auto& dict = const_cast<Dict&>(top->AsMap());
-        dict.emplace(*waiting_key_, Dict{});
-        auto it = dict.find(*waiting_key_);
-        nodes_stack_.push_back(&it->second);
+        nodes_stack_.push_back(&dict.AppendUnsorted(std::move(*waiting_key_), Dict{}).second);
         waiting_key_.reset();
         return DictItemContext(*this);
     }
@@ -135,7 +133,7 @@ inline DictItemContext Builder::StartDict() {
 
 inline ArrayItemContext Builder::StartArray() {
     if (completed_) throw std::logic_error("StartArray after Build or after value already set");
-    Node arr_node = Array{};
+    Node arr_node{Array{}};
     if (nodes_stack_.empty()) {
         root_ = std::move(arr_node);
         nodes_stack_.push_back(&root_);
@@ -150,9 +148,7 @@ inline ArrayItemContext Builder::StartArray() {
     }
     if (waiting_key_) {
         auto& dict = const_cast<Dict&>(top->AsMap());
-        dict.emplace(*waiting_key_, Array{});
-        auto it = dict.find(*waiting_key_);
-        nodes_stack_.push_back(&it->second);
+        nodes_stack_.push_back(&dict.AppendUnsorted(std::move(*waiting_key_), Array{}).second);
         waiting_key_.reset();
         return ArrayItemContext(*this);
     }
@@ -170,7 +166,7 @@ inline Builder& Builder::Value(Node::Value value) {
         }
         if (waiting_key_) {
             auto& dict = const_cast<Dict&>(top->AsMap());
-            dict.emplace(std::move(*waiting_key_), Node(std::move(value)));
+            dict.AppendUnsorted(std::move(*waiting_key_), Node(std::move(value)));
             waiting_key_.reset();
             return *this;
         }
@@ -203,7 +199,7 @@ inline ValueAfterKeyContext Builder::DoValue(Node::Value value) {
         Node* top = nodes_stack_.back();
         if (waiting_key_ && top->IsMap()) {
             auto& dict = const_cast<Dict&>(top->AsMap());
-            dict.emplace(std::move(*waiting_key_), Node(std::move(value)));
+            dict.AppendUnsorted(std::move(*waiting_key_), Node(std::move(value)));
             waiting_key_.reset();
             return ValueAfterKeyContext(*this);
         }
@@ -225,6 +221,8 @@ inline Builder& Builder::DoEndDict() {
     if (nodes_stack_.empty() || !nodes_stack_.back()->IsMap())
         throw std::logic_error("EndDict outside of dict");
     if (waiting_key_) throw std::logic_error("EndDict after Key");
+    // Ключи добавлялись в порядке вызовов; повторный ключ, как и прежде, не заменяет первый
+    const_cast<Dict&>(nodes_stack_.back()->AsMap()).SortKeys();
     nodes_stack_.pop_back();
     if (nodes_stack_.empty()) completed_ = true;
     return *this;
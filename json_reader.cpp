@@ -1,194 +1,481 @@
 #include "json_reader.h"
 #include "geo.h"
+#include <algorithm>
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <unordered_set>
-#include <sstream>
-#include "json_builder.h"
+#include <thread>
+#include "base_requests_loader.h"
 
-JsonReader::JsonReader(TransportCatalogue& db) : db_(db) {}
+namespace {
 
-void JsonReader::LoadData(const json::Document& doc) {
-    const auto& root = doc.GetRoot().AsMap();
-    const auto& base_requests = root.at("base_requests").AsArray();
-    
-    LoadStops(base_requests);
-    LoadDistances(base_requests);
-    LoadBuses(base_requests);
-    
-    if (root.count("routing_settings")) {
-        RoutingSettings routing_settings = ParseRoutingSettings(root.at("routing_settings").AsMap());
-        router_ = std::make_unique<TransportRouter>(db_);
-        router_->SetRoutingSettings(routing_settings);
+// Обработчик событий корневого словаря. Значение каждого ключа верхнего уровня
+// передаётся обработчику, выбранному select_target, либо, если тот вернул nullptr,
+// собирается в дерево и сохраняется в корневом словаре. После каждого значения
+// вызывается on_value. Массивы и словари деревьев размещаются в арене обработчика,
+// поэтому корневой словарь действителен, пока жив обработчик
+class DocumentHandler final : public json::EventHandler {
+public:
+    using TargetSelector = std::function<json::EventHandler*(std::string_view key)>;
+    using ValueCallback = std::function<void(std::string_view key, const json::Dict& root)>;
+
+    DocumentHandler(TargetSelector select_target, ValueCallback on_value)
+        : select_target_(std::move(select_target))
+        , on_value_(std::move(on_value)) {
+    }
+
+    void StartDict() override {
+        if (depth_++ > 0) {
+            Target().StartDict();
+        }
+    }
+    void Key(std::string_view key) override {
+        if (depth_ == 1) {
+            key_ = key;
+            target_ = select_target_(key_);
+            if (root_.count(key_) || streamed_keys_.count(key_)) {
+                throw json::ParsingError("Duplicate key '" + key_ + "' have been found");
+            }
+            if (target_) {
+                streamed_keys_.insert(key_);
+            }
+        } else {
+            Target().Key(key);
+        }
+    }
+    void EndDict() override {
+        if (--depth_ > 0) {
+            Target().EndDict();
+            AfterValue();
+        }
+    }
+    void StartArray() override {
+        CheckInsideRoot();
+        Target().StartArray();
+        ++depth_;
+    }
+    void EndArray() override {
+        --depth_;
+        Target().EndArray();
+        AfterValue();
+    }
+    void String(std::string_view value) override {
+        CheckInsideRoot();
+        Target().String(value);
+        AfterValue();
+    }
+    void Int(int value) override {
+        CheckInsideRoot();
+        Target().Int(value);
+        AfterValue();
+    }
+    void Double(double value) override {
+        CheckInsideRoot();
+        Target().Double(value);
+        AfterValue();
+    }
+    void Bool(bool value) override {
+        CheckInsideRoot();
+        Target().Bool(value);
+        AfterValue();
+    }
+    void Null() override {
+        CheckInsideRoot();
+        Target().Null();
+        AfterValue();
+    }
+
+    const json::Dict& GetRoot() const {
+        return root_;
+    }
+
+private:
+    json::EventHandler& Target() {
+        if (target_) {
+            return *target_;
+        }
+        return tree_;
+    }
+
+    void CheckInsideRoot() const {
+        if (depth_ == 0) {
+            throw std::logic_error("Node is not map");
+        }
+    }
+
+    void AfterValue() {
+        if (depth_ != 1) {
+            return;
+        }
+        if (!target_) {
+            root_.emplace(key_, tree_.Extract());
+        }
+        target_ = nullptr;
+        on_value_(key_, root_);
+    }
+
+    TargetSelector select_target_;
+    ValueCallback on_value_;
+    json::EventHandler* target_ = nullptr;
+    std::pmr::monotonic_buffer_resource nodes_;
+    json::TreeBuilder tree_{&nodes_};
+    json::Dict root_;
+    // Ключи, значения которых переданы другим обработчикам и не попали в root_
+    std::unordered_set<std::string> streamed_keys_;
+    std::string key_;
+    int depth_ = 0;
+};
+
+// Собирает в дерево каждый элемент массива и сразу передаёт его в callback.
+// Дерево строится в арене, которая освобождается после каждого элемента; небольшие
+// запросы целиком помещаются в её начальный буфер и не обращаются к куче
+class ArrayElementsHandler final : public json::EventHandler {
+public:
+    explicit ArrayElementsHandler(std::function<void(const json::Node&)> callback)
+        : callback_(std::move(callback)) {
+    }
+
+    void StartDict() override {
+        ++depth_;
+        tree_.StartDict();
+    }
+    void Key(std::string_view key) override {
+        tree_.Key(key);
+    }
+    void EndDict() override {
+        --depth_;
+        tree_.EndDict();
+        AfterValue();
+    }
+    void StartArray() override {
+        if (depth_++ > 0) {
+            tree_.StartArray();
+        }
+    }
+    void EndArray() override {
+        if (--depth_ > 0) {
+            tree_.EndArray();
+            AfterValue();
+        }
+    }
+    void String(std::string_view value) override {
+        tree_.String(value);
+        AfterValue();
+    }
+    void Int(int value) override {
+        tree_.Int(value);
+        AfterValue();
+    }
+    void Double(double value) override {
+        tree_.Double(value);
+        AfterValue();
+    }
+    void Bool(bool value) override {
+        tree_.Bool(value);
+        AfterValue();
+    }
+    void Null() override {
+        tree_.Null();
+        AfterValue();
     }
-}
 
-void JsonReader::LoadStops(const json::Array& base_requests) {
-    for (const auto& node : base_requests) {
-        const auto& dict = node.AsMap();
-        if (dict.at("type").AsString() == "Stop") {
-            Stop stop;
-            stop.name = dict.at("name").AsString();
-            stop.lat = dict.at("latitude").AsDouble();
-            stop.lng = dict.at("longitude").AsDouble();
-            db_.AddStop(stop);
+private:
+    void AfterValue() {
+        if (depth_ == 1) {
+            // Дерево разрушается до освобождения арены
+            callback_(tree_.Extract());
+            nodes_.release();
         }
     }
+
+    std::function<void(const json::Node&)> callback_;
+    char buffer_[4096];
+    std::pmr::monotonic_buffer_resource nodes_{buffer_, sizeof(buffer_)};
+    json::TreeBuilder tree_{&nodes_};
+    int depth_ = 0;
+};
+
+// Начиная с этого размера текста base_requests загружается в несколько потоков
+constexpr size_t PARALLEL_LOAD_MIN_SIZE = 1 << 20;
+
+// Ключи и значения корневого словаря, найденные быстрым просмотром документа;
+// nullopt, если его структура не распознана
+using RootMembers = std::optional<std::vector<json::Member>>;
+
+// Можно ли печатать ответы по мере разбора: stat_requests - последний и единственный
+// такой ключ корневого словаря. Тогда все настройки и поля формата вывода уже
+// прочитаны, а после начала вывода не встретится ни повтор ключа, ни поле, которое
+// меняет ответы. Если порядок ключей неизвестен, ответы печатаются после разбора
+bool CanStreamRequests(const RootMembers& members) {
+    if (!members || members->empty() || members->back().key != "stat_requests") {
+        return false;
+    }
+    return std::count_if(members->begin(), members->end(), [](const json::Member& member) {
+        return member.key == "stat_requests";
+    }) == 1;
 }
 
-void JsonReader::LoadDistances(const json::Array& base_requests) {
-    for (const auto& node : base_requests) {
-        const auto& dict = node.AsMap();
-        if (dict.at("type").AsString() == "Stop" && dict.count("road_distances")) {
-            const std::string& from = dict.at("name").AsString();
-            const Stop* from_stop = db_.FindStop(from);
-            const auto& distances = dict.at("road_distances").AsMap();
-            for (const auto& [to, dist] : distances) {
-                const Stop* to_stop = db_.FindStop(to);
-                if (from_stop && to_stop) {
-                    db_.SetDistance(from_stop, to_stop, dist.AsInt());
-                }
-            }
+// Разбирает документ, загружая большой массив base_requests в loader в несколько
+// потоков. Остальные значения корневого словаря разбираются по отдельности и вместе
+// с уже загруженным base_requests передаются handler так же, как при обычном разборе.
+// Если быстрый просмотр не распознал структуру документа, он разбирается целиком
+void ParseDocument(std::string_view input, const RootMembers& members, DocumentHandler& handler,
+                   BaseRequestsLoader& loader) {
+    const unsigned threads = std::thread::hardware_concurrency();
+    const bool parallel = threads > 1 && input.size() >= PARALLEL_LOAD_MIN_SIZE && members && std::any_of(members->begin(), members->end(), [](const json::Member& member) {
+        return member.key == "base_requests" && member.value.size() >= PARALLEL_LOAD_MIN_SIZE;
+    });
+    if (!parallel) {
+        json::Parse(input, handler);
+        return;
+    }
+
+    handler.StartDict();
+    for (const auto& [key, value] : *members) {
+        handler.Key(key);
+        if (key == "base_requests" && loader.LoadParallel(value, threads)) {
+            // Элементы уже загружены: обработчику достаточно узнать, что массив закончился
+            handler.StartArray();
+            handler.EndArray();
+        } else {
+            json::Parse(value, handler);
         }
     }
+    handler.EndDict();
 }
 
-void JsonReader::LoadBuses(const json::Array& base_requests) {
-    for (const auto& node : base_requests) {
-        const auto& dict = node.AsMap();
-        if (dict.at("type").AsString() == "Bus") {
-            Bus bus;
-            bus.name = dict.at("name").AsString();
-            for (const auto& stop_node : dict.at("stops").AsArray()) {
-                bus.stops.push_back(stop_node.AsString());
+}  // namespace
+
+JsonReader::JsonReader(TransportCatalogue& db) : db_(db) {}
+
+void JsonReader::SetOutputFormat(json::OutputFormat format) {
+    output_format_ = format;
+}
+
+void JsonReader::SetNumberPrecision(int precision) {
+    number_precision_ = ParseNumberPrecision(json::Node(precision));
+}
+
+void JsonReader::ProcessStream(std::string_view input, std::ostream& output) {
+    BaseRequestsLoader loader(db_);
+    std::optional<renderer::MapRenderer> map_renderer;
+    bool base_loaded = false;
+    json::OutputFormat format = output_format_;
+    int precision = number_precision_;
+
+    // Формат вывода фиксируется при первом ответе. Порядок ключей известен до разбора из
+    // быстрого просмотра документа: если за stat_requests что-то следует, запросы
+    // обрабатываются после разбора, и поля output_format и number_precision действуют,
+    // где бы ни стояли
+    const RootMembers members = json::SplitDict(input);
+    const bool stream_requests = CanStreamRequests(members);
+    std::optional<json::Writer> writer;
+    auto get_writer = [&writer, &output, &format, &precision]() -> json::Writer& {
+        if (!writer) {
+            writer.emplace(output, format, 0, NumberFormatter(precision));
+            writer->StartArray();
+        }
+        return *writer;
+    };
+    auto answer = [this, &get_writer, &map_renderer](const json::Node& request) {
+        ProcessRequest(request.AsMap(), *map_renderer, get_writer());
+    };
+    ArrayElementsHandler stat_requests(answer);
+
+    // Без base_requests или render_settings перед stat_requests запросы сохраняются
+    // целиком: ошибка об их отсутствии возникает после разбора, до начала вывода.
+    // routing_settings не обязательны: без них на запросы Route отвечают "not found"
+    DocumentHandler handler(
+        [&](std::string_view key) -> json::EventHandler* {
+            if (key == "base_requests") {
+                return &loader;
             }
-            bus.is_roundtrip = dict.at("is_roundtrip").AsBool();
-            db_.AddBus(bus);
+            if (key == "stat_requests" && stream_requests && base_loaded && map_renderer) {
+                return &stat_requests;
+            }
+            return nullptr;
+        },
+        [&](std::string_view key, const json::Dict& root) {
+            if (key == "base_requests") {
+                if (!loader.IsComplete()) {
+                    throw std::logic_error("Node is not array");
+                }
+                loader.Finish();
+                FinishCatalogue();
+                base_loaded = true;
+            } else if (key == "render_settings") {
+                map_renderer.emplace(ParseRenderSettings(root.at("render_settings").AsMap()));
+            } else if (key == "routing_settings") {
+                SetupRouter(root.at("routing_settings").AsMap());
+            } else if (key == "output_format") {
+                format = ParseOutputFormat(root.at(key));
+            } else if (key == "number_precision") {
+                precision = ParseNumberPrecision(root.at(key));
+            }
+        });
+    ParseDocument(input, members, handler, loader);
+
+    const json::Dict& root = handler.GetRoot();
+    if (!base_loaded) {
+        throw std::out_of_range("Input has no base_requests");
+    }
+    if (auto it = root.find("stat_requests"); it != root.end()) {
+        if (!map_renderer) {
+            map_renderer.emplace(ParseRenderSettings(root.at("render_settings").AsMap()));
+        }
+        for (const auto& request : it->second.AsArray()) {
+            answer(request);
         }
     }
+    get_writer().EndArray();
+    output.flush();
 }
 
-json::Array JsonReader::ProcessRequests(const json::Document& doc, const renderer::MapRenderer& map_renderer) {
-    json::Array responses;
-    const auto& stat_requests = doc.GetRoot().AsMap().at("stat_requests").AsArray();
-    for (const auto& request : stat_requests) {
-        const auto& dict = request.AsMap();
-        const std::string& type = dict.at("type").AsString();
-        
-        if (type == "Stop") {
-            responses.push_back(ProcessStopRequest(dict));
-        } else if (type == "Bus") {
-            responses.push_back(ProcessBusRequest(dict));
-        } else if (type == "Map") {
-            responses.push_back(ProcessMapRequest(dict, map_renderer));
-        } else if (type == "Route") {
-            responses.push_back(ProcessRouteRequest(dict));
-        }
+void JsonReader::FinishCatalogue() {
+    db_.Freeze();
+    spatial_index_ = std::make_unique<StopsSpatialIndex>(db_);
+}
+
+void JsonReader::SetupRouter(const json::Dict& settings) {
+    router_ = std::make_unique<TransportRouter>(db_);
+    router_->SetRoutingSettings(ParseRoutingSettings(settings));
+}
+
+bool JsonReader::ProcessRequest(const json::Dict& request, const renderer::MapRenderer& map_renderer,
+                                json::Writer& writer) {
+    std::string_view type = request.at("type").AsStringView();
+    if (type == "Stop") {
+        ProcessStopRequest(request, writer);
+    } else if (type == "Bus") {
+        ProcessBusRequest(request, writer);
+    } else if (type == "Map") {
+        ProcessMapRequest(request, map_renderer, writer);
+    } else if (type == "Route") {
+        ProcessRouteRequest(request, writer);
+    } else if (type == "RouteMap") {
+        ProcessRouteMapRequest(request, map_renderer, writer);
+    } else if (type == "NearestStops") {
+        ProcessNearestStopsRequest(request, writer);
+    } else {
+        return false;
     }
-    return responses;
+    return true;
 }
 
-json::Node JsonReader::ProcessStopRequest(const json::Dict& request) {
+// Ключи ответов записываются по возрастанию, как их упорядочивает json::Dict
+
+void JsonReader::ProcessStopRequest(const json::Dict& request, json::Writer& writer) {
     int id = request.at("id").AsInt();
-    const std::string& stop_name = request.at("name").AsString();
+    std::string_view stop_name = request.at("name").AsStringView();
     const Stop* stop = db_.FindStop(stop_name);
     
     if (!stop) {
-        return json::Builder{}
-            .StartDict()
-                .Key("request_id").Value(id)
-                .Key("error_message").Value("not found")
-            .EndDict()
-            .Build();
+        writer.StartDict()
+            .Key("error_message").Value("not found")
+            .Key("request_id").Value(id)
+            .EndDict();
     } else {
         auto buses_view = db_.GetBusesByStop(stop_name);
-        auto builder = json::Builder{};
-        builder.StartDict()
+        writer.StartDict()
             .Key("buses").StartArray();
         for (const auto& bus : buses_view) {
-            builder.Value(std::string(bus));
+            writer.Value(bus);
         }
-        return builder.EndArray()
+        writer.EndArray()
             .Key("request_id").Value(id)
-            .EndDict()
-            .Build();
+            .EndDict();
     }
 }
 
-json::Node JsonReader::ProcessBusRequest(const json::Dict& request) {
+void JsonReader::ProcessBusRequest(const json::Dict& request, json::Writer& writer) {
     int id = request.at("id").AsInt();
-    const std::string& bus_name = request.at("name").AsString();
+    std::string_view bus_name = request.at("name").AsStringView();
     const Bus* bus = db_.FindBus(bus_name);
     
     if (!bus) {
-        return json::Builder{}
-            .StartDict()
-                .Key("request_id").Value(id)
-                .Key("error_message").Value("not found")
-            .EndDict()
-            .Build();
+        writer.StartDict()
+            .Key("error_message").Value("not found")
+            .Key("request_id").Value(id)
+            .EndDict();
     } else {
         if (bus->stops.empty()) {
-            return json::Builder{}
-                .StartDict()
-                    .Key("curvature").Value(0.0)
-                    .Key("request_id").Value(id)
-                    .Key("route_length").Value(0)
-                    .Key("stop_count").Value(0)
-                    .Key("unique_stop_count").Value(0)
-                .EndDict()
-                .Build();
+            writer.StartDict()
+                .Key("curvature").Value(0.0)
+                .Key("request_id").Value(id)
+                .Key("route_length").Value(0)
+                .Key("stop_count").Value(0)
+                .Key("unique_stop_count").Value(0)
+                .EndDict();
+            return;
         }
         std::unordered_set<std::string_view> unique_stops(bus->stops.begin(), bus->stops.end());
         int unique_stop_count = static_cast<int>(unique_stops.size());
         int stop_count = bus->is_roundtrip ? static_cast<int>(bus->stops.size()) : static_cast<int>(bus->stops.size()) * 2 - 1;
+        // Неизвестные остановки пропускаются вместе с примыкающими перегонами
+        std::vector<const Stop*> stops;
+        std::vector<uint32_t> ids;
+        stops.reserve(bus->stops.size());
+        ids.reserve(bus->stops.size());
+        for (std::string_view stop_name : bus->stops) {
+            const Stop* stop = db_.FindStop(stop_name);
+            stops.push_back(stop);
+            ids.push_back(stop ? stop->id : 0);
+        }
+        std::vector<double> hop_lengths(stops.size() - 1);
+        db_.GetStopPoints().ComputePathDistances(ids.data(), ids.size(), hop_lengths.data());
+
         int route_length = 0;
         double geo_length = 0.0;
-        for (size_t i = 1; i < bus->stops.size(); ++i) {
-            const Stop* prev = db_.FindStop(bus->stops[i-1]);
-            const Stop* curr = db_.FindStop(bus->stops[i]);
-            if (prev && curr) {
-                int road_dist = db_.GetRoadDistanceBidirectional(prev, curr);
-                double geo_dist = geo::ComputeDistance({prev->lat, prev->lng}, {curr->lat, curr->lng});
-                route_length += road_dist;
-                geo_length += geo_dist;
+        for (size_t i = 1; i < stops.size(); ++i) {
+            if (stops[i-1] && stops[i]) {
+                route_length += db_.GetRoadDistanceBidirectional(stops[i-1], stops[i]);
+                geo_length += hop_lengths[i-1];
             }
         }
         if (!bus->is_roundtrip) {
-            for (size_t i = bus->stops.size() - 1; i > 0; --i) {
-                const Stop* prev = db_.FindStop(bus->stops[i]);
-                const Stop* curr = db_.FindStop(bus->stops[i-1]);
-                if (prev && curr) {
-                    int road_dist = db_.GetRoadDistanceBidirectional(prev, curr);
-                    double geo_dist = geo::ComputeDistance({prev->lat, prev->lng}, {curr->lat, curr->lng});
-                    route_length += road_dist;
-                    geo_length += geo_dist;
+            for (size_t i = stops.size() - 1; i > 0; --i) {
+                if (stops[i] && stops[i-1]) {
+                    route_length += db_.GetRoadDistanceBidirectional(stops[i], stops[i-1]);
+                    geo_length += hop_lengths[i-1];
                 }
             }
         }
         double curvature = geo_length > 0 ? static_cast<double>(route_length) / geo_length : 0.0;
-        return json::Builder{}
-            .StartDict()
-                .Key("curvature").Value(curvature)
-                .Key("request_id").Value(id)
-                .Key("route_length").Value(route_length)
-                .Key("stop_count").Value(stop_count)
-                .Key("unique_stop_count").Value(unique_stop_count)
-            .EndDict()
-            .Build();
+        writer.StartDict()
+            .Key("curvature").Value(curvature)
+            .Key("request_id").Value(id)
+            .Key("route_length").Value(route_length)
+            .Key("stop_count").Value(stop_count)
+            .Key("unique_stop_count").Value(unique_stop_count)
+            .EndDict();
     }
 }
 
-json::Node JsonReader::ProcessMapRequest(const json::Dict& request, const renderer::MapRenderer& map_renderer) {
+void JsonReader::ProcessMapRequest(const json::Dict& request, const renderer::MapRenderer& map_renderer,
+                                   json::Writer& writer) {
     int id = request.at("id").AsInt();
-    std::ostringstream svg_stream;
-    svg::Document svg_doc = map_renderer.RenderMap(db_);
-    svg_doc.Render(svg_stream);
-    return json::Builder{}
-        .StartDict()
-            .Key("map").Value(svg_stream.str())
+    const auto [viewport, error] = ParseMapArea(request, map_renderer);
+    if (!error.empty()) {
+        writer.StartDict()
+            .Key("error_message").Value(error)
             .Key("request_id").Value(id)
-        .EndDict()
-        .Build();
+            .EndDict();
+        return;
+    }
+    NumberFormatter& numbers = writer.GetNumberFormatter();
+    // SVG выводится прямо в ответ через экранирующий поток, минуя промежуточные строки
+    writer.StartDict()
+        .Key("map").StreamValue([&](std::ostream& out) {
+            if (viewport) {
+                svg::StreamDocument doc(out, numbers);
+                map_renderer.RenderViewport(db_, *viewport, doc);
+            } else {
+                map_renderer.RenderMap(db_, out, numbers);
+            }
+        })
+        .Key("request_id").Value(id)
+        .EndDict();
 }
 
 RenderSettings JsonReader::ParseRenderSettings(const json::Dict& settings) {
@@ -227,13 +514,13 @@ RenderSettings JsonReader::ParseRenderSettings(const json::Dict& settings) {
             );
         }
     } else if (underlayer_color.IsString()) {
-        result.underlayer_color = underlayer_color.AsString();
+        result.underlayer_color = std::string(underlayer_color.AsStringView());
     }
     
     const auto& palette = settings.at("color_palette").AsArray();
     for (const auto& color_node : palette) {
         if (color_node.IsString()) {
-            result.color_palette.push_back(color_node.AsString());
+            result.color_palette.push_back(std::string(color_node.AsStringView()));
         } else if (color_node.IsArray()) {
             const auto& color_array = color_node.AsArray();
             if (color_array.size() == 3) {
@@ -252,10 +539,63 @@ RenderSettings JsonReader::ParseRenderSettings(const json::Dict& settings) {
             }
         }
     }
+
+    if (settings.count("simplify_tolerance")) {
+        result.simplify_tolerance = settings.at("simplify_tolerance").AsDouble();
+    }
+    if (settings.count("compact_svg")) {
+        result.compact_svg = settings.at("compact_svg").AsBool();
+    }
+    if (settings.count("compact_svg_decimals")) {
+        result.compact_svg_decimals = settings.at("compact_svg_decimals").AsInt();
+    }
     
     return result;
 }
 
+json::OutputFormat JsonReader::ParseOutputFormat(const json::Node& format) {
+    std::string_view name = format.AsStringView();
+    if (name == "pretty") {
+        return json::OutputFormat::PRETTY;
+    }
+    if (name == "compact") {
+        return json::OutputFormat::COMPACT;
+    }
+    throw std::invalid_argument("Unknown output_format '" + std::string(name) + "'");
+}
+
+int JsonReader::ParseNumberPrecision(const json::Node& precision) {
+    const int value = precision.AsInt();
+    if (value < NumberFormatter::SHORTEST || value > NumberFormatter::MAX_PRECISION) {
+        throw std::invalid_argument("Unknown number_precision " + std::to_string(value));
+    }
+    return value;
+}
+
+JsonReader::MapArea JsonReader::ParseMapArea(const json::Dict& request,
+                                             const renderer::MapRenderer& map_renderer) {
+    if (auto it = request.find("viewport"); it != request.end()) {
+        const auto& viewport = it->second.AsMap();
+        renderer::Viewport result{viewport.at("min_x").AsDouble(), viewport.at("min_y").AsDouble(),
+                                  viewport.at("max_x").AsDouble(), viewport.at("max_y").AsDouble()};
+        if (result.min_x > result.max_x || result.min_y > result.max_y) {
+            return {std::nullopt, "invalid viewport"};
+        }
+        return {result, {}};
+    }
+    if (auto it = request.find("tile"); it != request.end()) {
+        const auto& tile = it->second.AsMap();
+        const int zoom = tile.at("z").AsInt();
+        const int x = tile.at("x").AsInt();
+        const int y = tile.at("y").AsInt();
+        if (zoom < 0 || zoom > 30 || x < 0 || y < 0 || x >= (1 << zoom) || y >= (1 << zoom)) {
+            return {std::nullopt, "invalid tile"};
+        }
+        return {map_renderer.GetTileViewport(zoom, x, y), {}};
+    }
+    return {};
+}
+
 RoutingSettings JsonReader::ParseRoutingSettings(const json::Dict& settings) {
     RoutingSettings result;
     result.bus_wait_time = settings.at("bus_wait_time").AsInt();
@@ -263,50 +603,88 @@ RoutingSettings JsonReader::ParseRoutingSettings(const json::Dict& settings) {
     return result;
 }
 
-json::Node JsonReader::ProcessRouteRequest(const json::Dict& request) {
+void JsonReader::ProcessRouteRequest(const json::Dict& request, json::Writer& writer) {
     int id = request.at("id").AsInt();
-    const std::string& from = request.at("from").AsString();
-    const std::string& to = request.at("to").AsString();
+    std::string_view from = request.at("from").AsStringView();
+    std::string_view to = request.at("to").AsStringView();
     
-    if (!router_) {
-        return json::Builder{}
-            .StartDict()
-                .Key("request_id").Value(id)
-                .Key("error_message").Value("not found")
-            .EndDict()
-            .Build();
-    }
-    
-    auto route = router_->BuildRoute(from, to);
+    auto route = router_ ? router_->BuildRoute(from, to) : std::nullopt;
     if (!route) {
-        return json::Builder{}
-            .StartDict()
-                .Key("request_id").Value(id)
-                .Key("error_message").Value("not found")
-            .EndDict()
-            .Build();
+        writer.StartDict()
+            .Key("error_message").Value("not found")
+            .Key("request_id").Value(id)
+            .EndDict();
+        return;
     }
     
-    auto builder = json::Builder{};
-    builder.StartDict()
-        .Key("request_id").Value(id)
-        .Key("total_time").Value(route->total_time)
+    writer.StartDict()
         .Key("items").StartArray();
-    
     for (const auto& item : route->items) {
-        builder.StartDict();
+        writer.StartDict();
         if (item.type == RouteItem::Type::Wait) {
-            builder.Key("type").Value("Wait")
-                  .Key("stop_name").Value(item.stop_name)
-                  .Key("time").Value(item.time);
+            writer.Key("stop_name").Value(item.stop_name)
+                  .Key("time").Value(item.time)
+                  .Key("type").Value("Wait");
         } else if (item.type == RouteItem::Type::Bus) {
-            builder.Key("type").Value("Bus")
-                  .Key("bus").Value(item.bus)
+            writer.Key("bus").Value(item.bus)
                   .Key("span_count").Value(item.span_count)
-                  .Key("time").Value(item.time);
+                  .Key("time").Value(item.time)
+                  .Key("type").Value("Bus");
         }
-        builder.EndDict();
+        writer.EndDict();
     }
-    
-    return builder.EndArray().EndDict().Build();
-}
\ No newline at end of file
+    writer.EndArray()
+        .Key("request_id").Value(id)
+        .Key("total_time").Value(route->total_time)
+        .EndDict();
+}
+
+void JsonReader::ProcessRouteMapRequest(const json::Dict& request, const renderer::MapRenderer& map_renderer,
+                                        json::Writer& writer) {
+    int id = request.at("id").AsInt();
+    std::string_view from = request.at("from").AsStringView();
+    std::string_view to = request.at("to").AsStringView();
+
+    auto route = router_ ? router_->BuildRoute(from, to) : std::nullopt;
+    if (!route) {
+        writer.StartDict()
+            .Key("error_message").Value("not found")
+            .Key("request_id").Value(id)
+            .EndDict();
+        return;
+    }
+    writer.StartDict()
+        .Key("map").StreamValue([&](std::ostream& out) {
+            map_renderer.RenderRouteMap(db_, *route, out, writer.GetNumberFormatter());
+        })
+        .Key("request_id").Value(id)
+        .EndDict();
+}
+
+void JsonReader::ProcessNearestStopsRequest(const json::Dict& request, json::Writer& writer) {
+    int id = request.at("id").AsInt();
+    geo::Coordinates center{request.at("latitude").AsDouble(), request.at("longitude").AsDouble()};
+
+    // Без radius ищем count ближайших (по умолчанию одну), без count - все в радиусе
+    std::vector<NearbyStop> nearby;
+    if (request.count("count")) {
+        double radius = request.count("radius") ? request.at("radius").AsDouble()
+                                                : std::numeric_limits<double>::infinity();
+        nearby = spatial_index_->FindNearest(center, static_cast<size_t>(std::max(request.at("count").AsInt(), 0)), radius);
+    } else if (request.count("radius")) {
+        nearby = spatial_index_->FindWithinRadius(center, request.at("radius").AsDouble());
+    } else {
+        nearby = spatial_index_->FindNearest(center, 1);
+    }
+
+    writer.StartDict()
+        .Key("request_id").Value(id)
+        .Key("stops").StartArray();
+    for (const auto& item : nearby) {
+        writer.StartDict()
+            .Key("distance").Value(item.distance)
+            .Key("name").Value(item.stop->name)
+            .EndDict();
+    }
+    writer.EndArray().EndDict();
+}
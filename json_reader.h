@@ -2,28 +2,64 @@
 
 #include "transport_catalogue.h"
 #include "transport_router.h"
+#include "spatial_index.h"
 #include "json.h"
 #include "map_renderer.h"
 
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string_view>
+
 class JsonReader {
 public:
     explicit JsonReader(TransportCatalogue& db);
-    
-    void LoadData(const json::Document& doc);
-    json::Array ProcessRequests(const json::Document& doc, const renderer::MapRenderer& map_renderer);
+
+    // Формат, в котором ProcessStream печатает ответы, если во входном документе
+    // нет поля output_format ("pretty" или "compact")
+    void SetOutputFormat(json::OutputFormat format);
+    // Число значащих цифр в дробных числах ответов, если во входном документе нет
+    // поля number_precision: от 1 до 17 или 0 для кратчайшей точной записи
+    void SetNumberPrecision(int precision);
+
+    // Обрабатывает входной документ целиком: загружает данные, читает настройки и
+    // печатает в output массив ответов. Если stat_requests - последний ключ документа,
+    // а base_requests и render_settings стоят раньше, каждый запрос обрабатывается и
+    // печатается сразу после разбора; иначе ответы печатаются после разбора всего
+    // документа. output сбрасывается один раз, после всех ответов. Ошибка в самом
+    // запросе (например, нет поля id) прерывает вывод исключением
+    void ProcessStream(std::string_view input, std::ostream& output);
     RenderSettings ParseRenderSettings(const json::Dict& settings);
     RoutingSettings ParseRoutingSettings(const json::Dict& settings);
+    json::OutputFormat ParseOutputFormat(const json::Node& format);
+    int ParseNumberPrecision(const json::Node& precision);
+    // Область запроса Map: поле viewport {min_x, min_y, max_x, max_y} в координатах
+    // карты или tile {z, x, y}. Без них запрашивается вся карта
+    struct MapArea {
+        std::optional<renderer::Viewport> viewport;
+        // Непусто, если viewport пуст или плитки с такими номерами нет: на такой запрос
+        // отвечают сообщением об ошибке, как на запрос неизвестной остановки
+        std::string_view error;
+    };
+    MapArea ParseMapArea(const json::Dict& request, const renderer::MapRenderer& map_renderer);
 
 private:
-    void LoadStops(const json::Array& base_requests);
-    void LoadDistances(const json::Array& base_requests);
-    void LoadBuses(const json::Array& base_requests);
-    
-    json::Node ProcessStopRequest(const json::Dict& request);
-    json::Node ProcessBusRequest(const json::Dict& request);
-    json::Node ProcessMapRequest(const json::Dict& request, const renderer::MapRenderer& map_renderer);
-    json::Node ProcessRouteRequest(const json::Dict& request);
+    void FinishCatalogue();
+    void SetupRouter(const json::Dict& settings);
+
+    // Записывает ответ на запрос в writer; возвращает false для запросов неизвестного типа
+    bool ProcessRequest(const json::Dict& request, const renderer::MapRenderer& map_renderer, json::Writer& writer);
+    void ProcessStopRequest(const json::Dict& request, json::Writer& writer);
+    void ProcessBusRequest(const json::Dict& request, json::Writer& writer);
+    void ProcessMapRequest(const json::Dict& request, const renderer::MapRenderer& map_renderer, json::Writer& writer);
+    void ProcessRouteRequest(const json::Dict& request, json::Writer& writer);
+    void ProcessRouteMapRequest(const json::Dict& request, const renderer::MapRenderer& map_renderer,
+                                json::Writer& writer);
+    void ProcessNearestStopsRequest(const json::Dict& request, json::Writer& writer);
     
     TransportCatalogue& db_;
     std::unique_ptr<TransportRouter> router_;
+    std::unique_ptr<StopsSpatialIndex> spatial_index_;
+    json::OutputFormat output_format_ = json::OutputFormat::PRETTY;
+    int number_precision_ = NumberFormatter::DEFAULT_PRECISION;
 };
\ No newline at end of file
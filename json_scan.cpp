@@ -0,0 +1,140 @@
+#include "json_scan.h"
+
+#include <cstdint>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#if defined(__SSE2__) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define JSON_SCAN_AVX2
+#include <immintrin.h>
+#endif
+
+namespace json::detail {
+
+namespace {
+
+bool IsStringSpecial(char c) {
+    return c == '"' || c == '\\' || c == '\n' || c == '\r';
+}
+
+// Пробельные символы: ' ' и диапазон от '\t' до '\r'
+bool IsSpace(char c) {
+    return c == ' ' || static_cast<unsigned char>(c - '\t') <= '\r' - '\t';
+}
+
+const char* FindStringSpecialScalar(const char* begin, const char* end) {
+    while (begin != end && !IsStringSpecial(*begin)) {
+        ++begin;
+    }
+    return begin;
+}
+
+const char* SkipWhitespaceScalar(const char* begin, const char* end) {
+    while (begin != end && IsSpace(*begin)) {
+        ++begin;
+    }
+    return begin;
+}
+
+#ifdef __SSE2__
+// Обрабатывают буфер блоками по 16 байт; неполный блок в конце досматривается
+// посимвольно, чтобы не читать за пределами буфера
+
+const char* FindStringSpecialSse2(const char* begin, const char* end) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i line_feed = _mm_set1_epi8('\n');
+    const __m128i carriage_return = _mm_set1_epi8('\r');
+    for (; end - begin >= 16; begin += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        const __m128i found = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, line_feed), _mm_cmpeq_epi8(chunk, carriage_return)));
+        if (const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(found)); mask != 0) {
+            return begin + __builtin_ctz(mask);
+        }
+    }
+    return FindStringSpecialScalar(begin, end);
+}
+
+const char* SkipWhitespaceSse2(const char* begin, const char* end) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i control_range = _mm_set1_epi8('\r' - '\t');
+    for (; end - begin >= 16; begin += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        // c - '\t' <= '\r' - '\t' без знака  <=>  min(c - '\t', '\r' - '\t') == c - '\t'
+        const __m128i shifted = _mm_sub_epi8(chunk, tab);
+        const __m128i is_control = _mm_cmpeq_epi8(_mm_min_epu8(shifted, control_range), shifted);
+        const __m128i is_space = _mm_or_si128(_mm_cmpeq_epi8(chunk, space), is_control);
+        if (const unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(is_space)) & 0xFFFFu; mask != 0) {
+            return begin + __builtin_ctz(mask);
+        }
+    }
+    return SkipWhitespaceScalar(begin, end);
+}
+#endif
+
+#ifdef JSON_SCAN_AVX2
+// Те же алгоритмы для блоков по 32 байта. Компилируются с поддержкой AVX2 независимо
+// от флагов сборки и вызываются, только если процессор её поддерживает
+
+__attribute__((target("avx2")))
+const char* FindStringSpecialAvx2(const char* begin, const char* end) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i line_feed = _mm256_set1_epi8('\n');
+    const __m256i carriage_return = _mm256_set1_epi8('\r');
+    for (; end - begin >= 32; begin += 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+        const __m256i found = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, line_feed), _mm256_cmpeq_epi8(chunk, carriage_return)));
+        if (const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(found)); mask != 0) {
+            return begin + __builtin_ctz(mask);
+        }
+    }
+    return FindStringSpecialSse2(begin, end);
+}
+
+__attribute__((target("avx2")))
+const char* SkipWhitespaceAvx2(const char* begin, const char* end) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i control_range = _mm256_set1_epi8('\r' - '\t');
+    for (; end - begin >= 32; begin += 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+        const __m256i shifted = _mm256_sub_epi8(chunk, tab);
+        const __m256i is_control = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, control_range), shifted);
+        const __m256i is_space = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, space), is_control);
+        if (const uint32_t mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(is_space)); mask != 0) {
+            return begin + __builtin_ctz(mask);
+        }
+    }
+    return SkipWhitespaceSse2(begin, end);
+}
+#endif
+
+TextScanner SelectTextScanner() {
+#ifdef JSON_SCAN_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        return {FindStringSpecialAvx2, SkipWhitespaceAvx2};
+    }
+#endif
+#ifdef __SSE2__
+    return {FindStringSpecialSse2, SkipWhitespaceSse2};
+#else
+    return {FindStringSpecialScalar, SkipWhitespaceScalar};
+#endif
+}
+
+}  // namespace
+
+const TextScanner& GetTextScanner() {
+    static const TextScanner scanner = SelectTextScanner();
+    return scanner;
+}
+
+}  // namespace json::detail
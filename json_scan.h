@@ -0,0 +1,20 @@
+#pragma once
+
+namespace json::detail {
+
+// Функция поиска по участку [begin, end) входного буфера. Возвращает указатель на
+// найденный символ или end
+using ScanFunction = const char* (*)(const char* begin, const char* end);
+
+struct TextScanner {
+    // Первый символ, прерывающий строку: ", \, \n или \r
+    ScanFunction find_string_special;
+    // Первый символ, не являющийся пробельным
+    ScanFunction skip_whitespace;
+};
+
+// Реализация для текущего процессора: AVX2, если он поддерживает эти инструкции,
+// иначе SSE2, а на других архитектурах - посимвольная
+const TextScanner& GetTextScanner();
+
+}  // namespace json::detail
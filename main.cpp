@@ -1,22 +1,68 @@
 #include "json.h"
 #include "json_reader.h"
-#include "map_renderer.h"
+#include "number_format.h"
 
+#include <charconv>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <string_view>
 
-int main() {
-    const json::Document input = json::Load(std::cin);
-    const auto& root = input.GetRoot().AsMap();
+namespace {
 
-    TransportCatalogue catalogue;
-    JsonReader reader(catalogue);
-    reader.LoadData(input);
+void PrintUsage(std::string_view program) {
+    std::cerr << "Usage: " << program << " [--compact] [--precision=N]\n"
+              << "  --compact      print responses without line breaks and indentation\n"
+              << "  --precision=N  significant digits in fractional numbers, from "
+              << NumberFormatter::SHORTEST << " (shortest exact form) to "
+              << NumberFormatter::MAX_PRECISION << std::endl;
+}
 
-    RenderSettings render_settings = reader.ParseRenderSettings(root.at("render_settings").AsMap());
-    renderer::MapRenderer map_renderer(render_settings);
+// Разбирает N из --precision=N. Значение должно быть целым числом без лишних символов
+// в диапазоне от NumberFormatter::SHORTEST до NumberFormatter::MAX_PRECISION
+bool ParsePrecision(std::string_view text, int& precision) {
+    const char* end = text.data() + text.size();
+    const auto [ptr, ec] = std::from_chars(text.data(), end, precision);
+    return ec == std::errc() && ptr == end
+        && precision >= NumberFormatter::SHORTEST && precision <= NumberFormatter::MAX_PRECISION;
+}
 
-    json::Array responses = reader.ProcessRequests(input, map_renderer);
-    json::Document output{responses};
-    json::Print(output, std::cout);
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    TransportCatalogue catalogue;
+    JsonReader reader(catalogue);
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg(argv[i]);
+        constexpr std::string_view precision_flag = "--precision=";
+        // --compact: ответы без переводов строк и отступов
+        if (arg == "--compact") {
+            reader.SetOutputFormat(json::OutputFormat::COMPACT);
+            continue;
+        }
+        // --precision=N: N значащих цифр в дробных числах, 0 - кратчайшая точная запись
+        if (arg.substr(0, precision_flag.size()) == precision_flag) {
+            int precision = 0;
+            if (ParsePrecision(arg.substr(precision_flag.size()), precision)) {
+                reader.SetNumberPrecision(precision);
+                continue;
+            }
+            std::cerr << "Invalid value in " << arg << std::endl;
+        } else {
+            std::cerr << "Unknown option " << arg << std::endl;
+        }
+        PrintUsage(argv[0]);
+        return 2;
+    }
+    // Ответы печатаются по мере обработки запросов. Если обработка прервалась,
+    // напечатанная часть ответов неполна: об этом сообщается в stderr и кодом возврата
+    try {
+        reader.ProcessStream(json::ReadAll(std::cin), std::cout);
+    } catch (const std::exception& e) {
+        std::cout.flush();
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
 
     return 0;
 }
@@ -1,7 +1,14 @@
 #include "map_renderer.h"
 #include "geo.h"
 #include <algorithm>
-#include <set>
+#include <atomic>
+#include <cmath>
+#include <future>
+#include <limits>
+#include <sstream>
+#include <thread>
+#include <type_traits>
+#include <utility>
 
 using namespace std::literals;
 using namespace svg;
@@ -59,195 +66,854 @@ private:
     double zoom_coeff_ = 0.0;
 };
 
+namespace {
+
+// Классы стилей компактного режима
+constexpr std::string_view BUS_LINE_CLASS = "l"sv;
+constexpr std::string_view ROUTE_HALO_CLASS = "h"sv;
+constexpr std::string_view UNDERLAYER_CLASS = "u"sv;
+constexpr std::string_view BUS_LABEL_CLASS = "b"sv;
+constexpr std::string_view STOP_LABEL_CLASS = "s"sv;
+constexpr std::string_view BUS_UNDERLAYER_CLASSES = "u b"sv;
+constexpr std::string_view STOP_UNDERLAYER_CLASSES = "u s"sv;
+
+// Число фигур карты, начиная с которого слои рисуются в нескольких потоках
+constexpr size_t PARALLEL_RENDER_MIN_OBJECTS = 1 << 14;
+// Частей на поток: мелкие части выравнивают нагрузку, когда слои различаются по объёму
+constexpr size_t CHUNKS_PER_THREAD = 4;
+
+bool Contains(const Viewport& area, svg::Point point) {
+    return area.min_x <= point.x && point.x <= area.max_x
+        && area.min_y <= point.y && point.y <= area.max_y;
+}
+
+// Отсечение Лианга - Барски: параметры t0 <= t1 части отрезка from + t * (to - from),
+// лежащей в области. Если отрезок не обрезан с какой-то стороны, параметр равен
+// ровно 0 или 1
+std::optional<std::pair<double, double>> ClipSegment(svg::Point from, svg::Point to, const Viewport& area) {
+    const double dx = to.x - from.x;
+    const double dy = to.y - from.y;
+    double t0 = 0.0;
+    double t1 = 1.0;
+    // Для каждой стороны: p * t <= q
+    const double p[] = {-dx, dx, -dy, dy};
+    const double q[] = {from.x - area.min_x, area.max_x - from.x, from.y - area.min_y, area.max_y - from.y};
+    for (int i = 0; i < 4; ++i) {
+        if (p[i] == 0.0) {
+            if (q[i] < 0.0) {
+                return std::nullopt;
+            }
+        } else if (const double t = q[i] / p[i]; p[i] < 0.0) {
+            t0 = std::max(t0, t);
+        } else {
+            t1 = std::min(t1, t);
+        }
+    }
+    if (t0 > t1) {
+        return std::nullopt;
+    }
+    return std::make_pair(t0, t1);
+}
+
+double SquaredDistance(svg::Point lhs, svg::Point rhs) {
+    const double dx = lhs.x - rhs.x;
+    const double dy = lhs.y - rhs.y;
+    return dx * dx + dy * dy;
+}
+
+// Квадрат расстояния от point до отрезка [from, to]
+double SquaredDistanceToSegment(svg::Point point, svg::Point from, svg::Point to) {
+    const double dx = to.x - from.x;
+    const double dy = to.y - from.y;
+    const double length = dx * dx + dy * dy;
+    if (length == 0.0) {
+        return SquaredDistance(point, from);
+    }
+    const double t = std::clamp(((point.x - from.x) * dx + (point.y - from.y) * dy) / length, 0.0, 1.0);
+    return SquaredDistance(point, {from.x + dx * t, from.y + dy * t});
+}
+
+// Упрощает ломаную из вершин indices[begin..] по алгоритму Дугласа - Пекера,
+// сохраняя крайние вершины и порядок оставшихся. Рекурсия заменена стеком отрезков
+void SimplifyPolyline(std::vector<uint32_t>& indices, size_t begin,
+                      const std::vector<svg::Point>& points, double tolerance) {
+    const size_t count = indices.size() - begin;
+    if (count < 3) return;
+
+    const double squared_tolerance = tolerance * tolerance;
+    std::vector<bool> keep(count, false);
+    keep.front() = keep.back() = true;
+    std::vector<std::pair<size_t, size_t>> ranges{{0, count - 1}};
+    while (!ranges.empty()) {
+        const auto [first, last] = ranges.back();
+        ranges.pop_back();
+        const svg::Point& from = points[indices[begin + first]];
+        const svg::Point& to = points[indices[begin + last]];
+        double max_distance = 0.0;
+        size_t farthest = first;
+        for (size_t i = first + 1; i < last; ++i) {
+            const double distance = SquaredDistanceToSegment(points[indices[begin + i]], from, to);
+            if (distance > max_distance) {
+                max_distance = distance;
+                farthest = i;
+            }
+        }
+        if (max_distance > squared_tolerance) {
+            keep[farthest] = true;
+            ranges.emplace_back(first, farthest);
+            ranges.emplace_back(farthest, last);
+        }
+    }
+
+    size_t kept = begin;
+    for (size_t i = 0; i < count; ++i) {
+        if (keep[i]) {
+            indices[kept++] = indices[begin + i];
+        }
+    }
+    indices.resize(kept);
+}
+
+svg::Point Interpolate(svg::Point from, svg::Point to, double t) {
+    if (t == 0.0) return from;
+    if (t == 1.0) return to;
+    return {from.x + (to.x - from.x) * t, from.y + (to.y - from.y) * t};
+}
+
+// Буфер потока без собственного буфера: передаёт записанный текст в out и
+// одновременно дописывает его в copy
+class TeeStreamBuf : public std::streambuf {
+public:
+    TeeStreamBuf(std::ostream& out, std::string& copy)
+        : out_(out)
+        , copy_(copy) {
+    }
+
+protected:
+    int_type overflow(int_type c) override {
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            const char ch = traits_type::to_char_type(c);
+            xsputn(&ch, 1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char* data, std::streamsize size) override {
+        out_.write(data, size);
+        copy_.append(data, static_cast<size_t>(size));
+        return size;
+    }
+
+    int sync() override {
+        out_.flush();
+        return out_ ? 0 : -1;
+    }
+
+private:
+    std::ostream& out_;
+    std::string& copy_;
+};
+
+}  // namespace
+
 MapRenderer::MapRenderer(const RenderSettings& settings)
     : settings_(settings) {}
 
+template <typename Doc>
+void MapRenderer::DrawStyle(Doc& doc) const {
+    if (!settings_.compact_svg) return;
+
+    auto declarations = [](auto&&... parts) {
+        std::ostringstream out;
+        (out << ... << parts);
+        return out.str();
+    };
+    const std::string line_props = "stroke-linecap:round;stroke-linejoin:round"s;
+    svg::Style style;
+    style.AddRule("."s + std::string(BUS_LINE_CLASS),
+                  declarations("fill:none;stroke-width:", settings_.line_width, "px;", line_props))
+         .AddRule("."s + std::string(ROUTE_HALO_CLASS),
+                  declarations("fill:none;stroke:", settings_.underlayer_color, ";stroke-width:",
+                               settings_.line_width + 2 * settings_.underlayer_width, "px;", line_props))
+         .AddRule("."s + std::string(UNDERLAYER_CLASS),
+                  declarations("fill:", settings_.underlayer_color, ";stroke:", settings_.underlayer_color,
+                               ";stroke-width:", settings_.underlayer_width, "px;", line_props))
+         .AddRule("."s + std::string(BUS_LABEL_CLASS), "font-family:Verdana;font-weight:bold"sv)
+         .AddRule("."s + std::string(STOP_LABEL_CLASS), "font-family:Verdana"sv);
+    doc.Add(style);
+}
+
+template <typename Callback>
+void MapRenderer::WithBusLineShape(Callback&& draw) const {
+    if (settings_.compact_svg) {
+        svg::Path path;
+        draw(path);
+    } else {
+        svg::Polyline polyline;
+        draw(polyline);
+    }
+}
+
+template <typename Line>
+void MapRenderer::SetBusLineStyle(Line& line, size_t color_index) const {
+    line.ClearPoints();
+    line.SetStrokeColor(settings_.color_palette[color_index % settings_.color_palette.size()]);
+    if constexpr (std::is_same_v<Line, svg::Path>) {
+        line.SetDecimals(settings_.compact_svg_decimals);
+        line.SetClass(BUS_LINE_CLASS);
+    } else {
+        line.SetFillColor("none");
+        line.SetStrokeWidth(settings_.line_width);
+        line.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
+        line.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+    }
+}
+
+template <typename Line>
+void MapRenderer::SetRouteHaloStyle(Line& line) const {
+    line.ClearPoints();
+    if constexpr (std::is_same_v<Line, svg::Path>) {
+        line.SetDecimals(settings_.compact_svg_decimals);
+        line.SetClass(ROUTE_HALO_CLASS);
+    } else {
+        line.SetFillColor("none");
+        line.SetStrokeColor(settings_.underlayer_color);
+        line.SetStrokeWidth(settings_.line_width + 2 * settings_.underlayer_width);
+        line.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
+        line.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+    }
+}
+
 svg::Document MapRenderer::RenderMap(const TransportCatalogue& db) const {
     svg::Document doc;
+    Draw(doc, GetModel(db));
+    return doc;
+}
 
-    std::vector<Coordinates> geo_coords;
-    std::set<std::string_view> seen_stops;
+void MapRenderer::RenderMap(const TransportCatalogue& db, svg::StreamDocument& doc) const {
+    Draw(doc, GetModel(db));
+    doc.Finish();
+}
+
+const std::string& MapRenderer::RenderMapText(const TransportCatalogue& db, NumberFormatter& numbers) const {
+    if (!cache_ || cache_->catalogue_version != db.GetVersion() || cache_->precision != numbers.GetPrecision()) {
+        std::ostringstream out;
+        svg::StreamDocument doc(out, numbers);
+        DrawMap(doc, GetModel(db), numbers.GetPrecision());
+        cache_ = CachedMap{db.GetVersion(), numbers.GetPrecision(), out.str()};
+    }
+    return cache_->text;
+}
+
+void MapRenderer::RenderMap(const TransportCatalogue& db, std::ostream& out, NumberFormatter& numbers) const {
+    if (cache_ && cache_->catalogue_version == db.GetVersion() && cache_->precision == numbers.GetPrecision()) {
+        out << cache_->text;
+        return;
+    }
+    // Карта выводится в out по мере отрисовки, а её копия становится кешем
+    std::string text;
+    {
+        TeeStreamBuf tee(out, text);
+        std::ostream tee_out(&tee);
+        svg::StreamDocument doc(tee_out, numbers);
+        DrawMap(doc, GetModel(db), numbers.GetPrecision());
+    }
+    cache_ = CachedMap{db.GetVersion(), numbers.GetPrecision(), std::move(text)};
+}
+
+void MapRenderer::RenderRouteMap(const TransportCatalogue& db, const RouteInfo& route, std::ostream& out,
+                                 NumberFormatter& numbers) const {
+    static constexpr std::string_view CLOSING_TAG = "</svg>"sv;
+    // Наложение выводится перед закрывающим тегом кешированной карты
+    const std::string& base = RenderMapText(db, numbers);
+    out.write(base.data(), static_cast<std::streamsize>(base.size() - CLOSING_TAG.size()));
+    svg::StreamFragment fragment(out, numbers);
+    DrawRouteOverlay(fragment, db, GetModel(db), route);
+    out << CLOSING_TAG;
+}
+
+Viewport MapRenderer::GetTileViewport(int zoom, int x, int y) const {
+    const double tiles = std::ldexp(1.0, zoom);
+    const double tile_width = settings_.width / tiles;
+    const double tile_height = settings_.height / tiles;
+    return {x * tile_width, y * tile_height, (x + 1) * tile_width, (y + 1) * tile_height};
+}
+
+void MapRenderer::RenderViewport(const TransportCatalogue& db, const Viewport& viewport,
+                                 svg::StreamDocument& doc) const {
+    const double margin = std::max(settings_.stop_radius, settings_.line_width / 2);
+    DrawViewport(doc, GetModel(db), {viewport.min_x - margin, viewport.min_y - margin,
+                                     viewport.max_x + margin, viewport.max_y + margin});
+    doc.Finish();
+}
 
-    for (const auto& bus : db.GetAllBuses()) {
+const MapRenderer::RenderModel& MapRenderer::GetModel(const TransportCatalogue& db) const {
+    if (!model_ || model_->catalogue_version != db.GetVersion()) {
+        model_ = BuildModel(db);
+    }
+    return *model_;
+}
+
+MapRenderer::RenderModel MapRenderer::BuildModel(const TransportCatalogue& db) const {
+    constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+    RenderModel model;
+    model.catalogue_version = db.GetVersion();
+
+    // Единственный проход с поиском по именам: остановки каждого маршрута
+    // заменяются указателями, отсутствующие в справочнике - nullptr
+    const auto& buses = db.GetAllBuses();
+    std::vector<uint32_t> bus_stops_begin;
+    std::vector<const Stop*> bus_stops;
+    std::vector<uint32_t> index_by_id(db.GetAllStops().size(), NONE);
+    bus_stops_begin.reserve(buses.size() + 1);
+    for (const auto& bus : buses) {
+        bus_stops_begin.push_back(static_cast<uint32_t>(bus_stops.size()));
         for (const auto& stop_name : bus.stops) {
             const Stop* stop = db.FindStop(stop_name);
-            if (stop && seen_stops.insert(stop->name).second) {
-                geo_coords.push_back({stop->lat, stop->lng});
+            bus_stops.push_back(stop);
+            if (stop && index_by_id[stop->id] == NONE) {
+                index_by_id[stop->id] = 0;
+                model.stops.push_back(stop);
             }
         }
     }
+    bus_stops_begin.push_back(static_cast<uint32_t>(bus_stops.size()));
 
+    std::sort(model.stops.begin(), model.stops.end(),
+        [](const Stop* lhs, const Stop* rhs) {
+            return lhs->name < rhs->name;
+        }
+    );
+    std::vector<Coordinates> geo_coords;
+    geo_coords.reserve(model.stops.size());
+    for (size_t i = 0; i < model.stops.size(); ++i) {
+        index_by_id[model.stops[i]->id] = static_cast<uint32_t>(i);
+        geo_coords.push_back({model.stops[i]->lat, model.stops[i]->lng});
+    }
     SphereProjector projector(geo_coords.begin(), geo_coords.end(),
                             settings_.width, settings_.height, settings_.padding);
+    model.points.reserve(geo_coords.size());
+    for (const Coordinates& coords : geo_coords) {
+        model.points.push_back(projector(coords));
+    }
 
-    auto buses = db.GetAllBuses();
-    std::vector<const Bus*> sorted_buses;
-    for (const auto& bus : buses) {
-        sorted_buses.push_back(&bus);
+    std::vector<size_t> sorted_buses(buses.size());
+    for (size_t i = 0; i < buses.size(); ++i) {
+        sorted_buses[i] = i;
     }
     std::sort(sorted_buses.begin(), sorted_buses.end(),
-        [](const Bus* lhs, const Bus* rhs) {
-            return lhs->name < rhs->name;
+        [&buses](size_t lhs, size_t rhs) {
+            return buses[lhs].name < buses[rhs].name;
         }
     );
 
-    DrawBusLines(doc, db, sorted_buses, projector);
-    DrawBusLabels(doc, db, sorted_buses, projector);
-    
-    auto stops_to_render = CollectStopsToRender(db, buses);
-    DrawStopCircles(doc, stops_to_render, projector);
-    DrawStopLabels(doc, stops_to_render, projector);
+    auto add_point = [&index_by_id](std::vector<uint32_t>& points, const Stop* stop) {
+        if (stop) {
+            points.push_back(index_by_id[stop->id]);
+        }
+    };
+    for (size_t bus_index : sorted_buses) {
+        const Bus& bus = buses[bus_index];
+        if (bus.stops.empty()) continue;
+
+        const Stop* const* stops = bus_stops.data() + bus_stops_begin[bus_index];
+        const size_t n = bus.stops.size();
+        RenderModel::BusLine line;
+        line.name = bus.name;
+        line.color_index = model.buses.size();
 
-    return doc;
+        // Некольцевой маршрут проходится туда и обратно
+        line.polyline_begin = static_cast<uint32_t>(model.polyline_points.size());
+        for (size_t i = 0; i < n; ++i) {
+            add_point(model.polyline_points, stops[i]);
+        }
+        if (!bus.is_roundtrip) {
+            for (size_t i = n - 1; i > 0; --i) {
+                add_point(model.polyline_points, stops[i - 1]);
+            }
+        }
+        if (settings_.simplify_tolerance > 0.0) {
+            SimplifyPolyline(model.polyline_points, line.polyline_begin, model.points, settings_.simplify_tolerance);
+        }
+        line.polyline_end = static_cast<uint32_t>(model.polyline_points.size());
+
+        line.terminals_begin = static_cast<uint32_t>(model.terminal_points.size());
+        add_point(model.terminal_points, stops[0]);
+        if (!bus.is_roundtrip && stops[n - 1] != stops[0]) {
+            add_point(model.terminal_points, stops[n - 1]);
+        }
+        line.terminals_end = static_cast<uint32_t>(model.terminal_points.size());
+
+        model.buses.push_back(line);
+    }
+    return model;
 }
 
-void MapRenderer::DrawBusLines(svg::Document& doc, const TransportCatalogue& db,
-                              const std::vector<const Bus*>& sorted_buses,
-                              const SphereProjector& projector) const {
-    size_t color_index = 0;
-    
-    for (const auto* bus : sorted_buses) {
-        if (bus->stops.empty()) continue;
+const MapRenderer::GeometryGrid& MapRenderer::GetGrid(const RenderModel& model) const {
+    if (!grid_ || grid_->catalogue_version != model.catalogue_version) {
+        grid_ = BuildGrid(model);
+    }
+    return *grid_;
+}
 
-        svg::Polyline polyline;
-        polyline.SetStrokeColor(settings_.color_palette[color_index % settings_.color_palette.size()]);
-        polyline.SetFillColor("none");
-        polyline.SetStrokeWidth(settings_.line_width);
-        polyline.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
-        polyline.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-
-        if (bus->is_roundtrip) {
-            for (const auto& stop_name : bus->stops) {
-                const Stop* stop = db.FindStop(stop_name);
-                if (stop) {
-                    polyline.AddPoint(projector({stop->lat, stop->lng}));
-                }
-            }
-        } else {
-            size_t n = bus->stops.size();
-            for (size_t i = 0; i < n; ++i) {
-                const Stop* stop = db.FindStop(bus->stops[i]);
-                if (stop) {
-                    polyline.AddPoint(projector({stop->lat, stop->lng}));
+MapRenderer::GeometryGrid MapRenderer::BuildGrid(const RenderModel& model) const {
+    GeometryGrid grid;
+    grid.catalogue_version = model.catalogue_version;
+    if (model.points.empty()) {
+        grid.stop_cells_begin.assign(1, 0);
+        grid.segment_cells_begin.assign(1, 0);
+        return grid;
+    }
+
+    double max_x = model.points.front().x;
+    double max_y = model.points.front().y;
+    grid.min_x = max_x;
+    grid.min_y = max_y;
+    for (const svg::Point& point : model.points) {
+        grid.min_x = std::min(grid.min_x, point.x);
+        grid.min_y = std::min(grid.min_y, point.y);
+        max_x = std::max(max_x, point.x);
+        max_y = std::max(max_y, point.y);
+    }
+    // В среднем около одной остановки на ячейку
+    const double extent = std::max({max_x - grid.min_x, max_y - grid.min_y, 1.0});
+    const double side = std::ceil(std::sqrt(static_cast<double>(model.points.size())));
+    grid.cell_size = extent / side;
+    grid.columns = static_cast<size_t>((max_x - grid.min_x) / grid.cell_size) + 1;
+    grid.rows = static_cast<size_t>((max_y - grid.min_y) / grid.cell_size) + 1;
+
+    auto column = [&grid](double x) {
+        return std::min(static_cast<size_t>(std::max(0.0, (x - grid.min_x) / grid.cell_size)), grid.columns - 1);
+    };
+    auto row = [&grid](double y) {
+        return std::min(static_cast<size_t>(std::max(0.0, (y - grid.min_y) / grid.cell_size)), grid.rows - 1);
+    };
+
+    // Пары (ячейка, элемент) раскладываются по ячейкам подсчётом
+    auto distribute = [&grid](const std::vector<std::pair<uint32_t, uint32_t>>& entries,
+                              std::vector<uint32_t>& cells_begin, std::vector<uint32_t>& items) {
+        cells_begin.assign(grid.columns * grid.rows + 1, 0);
+        for (const auto& [cell, item] : entries) {
+            ++cells_begin[cell + 1];
+        }
+        for (size_t cell = 1; cell < cells_begin.size(); ++cell) {
+            cells_begin[cell] += cells_begin[cell - 1];
+        }
+        items.resize(entries.size());
+        std::vector<uint32_t> fill(cells_begin.begin(), cells_begin.end() - 1);
+        for (const auto& [cell, item] : entries) {
+            items[fill[cell]++] = item;
+        }
+    };
+
+    std::vector<std::pair<uint32_t, uint32_t>> entries;
+    entries.reserve(model.points.size());
+    for (size_t i = 0; i < model.points.size(); ++i) {
+        const svg::Point& point = model.points[i];
+        entries.emplace_back(static_cast<uint32_t>(row(point.y) * grid.columns + column(point.x)),
+                             static_cast<uint32_t>(i));
+    }
+    distribute(entries, grid.stop_cells_begin, grid.stop_items);
+
+    // Отрезок заносится только в ячейки, которые он пересекает: в каждой строке
+    // сетки берутся столбцы, через которые проходит часть отрезка внутри этой строки.
+    // Так число записей растёт с длиной отрезка, а не с площадью его габаритов.
+    // Границы расширены на eps, чтобы отрезок, проходящий по границе ячеек, попал в обе
+    const double eps = grid.cell_size * 1e-9;
+    entries.clear();
+    for (const auto& line : model.buses) {
+        for (uint32_t i = line.polyline_begin; i + 1 < line.polyline_end; ++i) {
+            const svg::Point& from = model.points[model.polyline_points[i]];
+            const svg::Point& to = model.points[model.polyline_points[i + 1]];
+            const double min_y = std::min(from.y, to.y);
+            const double max_y = std::max(from.y, to.y);
+            const double dx_dy = to.y != from.y ? (to.x - from.x) / (to.y - from.y) : 0.0;
+            const size_t last_row = row(max_y + eps);
+            for (size_t r = row(min_y - eps); r <= last_row; ++r) {
+                double x_begin = from.x;
+                double x_end = to.x;
+                if (to.y != from.y) {
+                    const double y_begin = std::max(min_y, grid.min_y + r * grid.cell_size);
+                    const double y_end = std::min(max_y, grid.min_y + (r + 1) * grid.cell_size);
+                    x_begin = from.x + (y_begin - from.y) * dx_dy;
+                    x_end = from.x + (y_end - from.y) * dx_dy;
                 }
-            }
-            for (size_t i = n - 2; i < n; --i) {
-                const Stop* stop = db.FindStop(bus->stops[i]);
-                if (stop) {
-                    polyline.AddPoint(projector({stop->lat, stop->lng}));
+                const size_t last_column = column(std::max(x_begin, x_end) + eps);
+                for (size_t c = column(std::min(x_begin, x_end) - eps); c <= last_column; ++c) {
+                    entries.emplace_back(static_cast<uint32_t>(r * grid.columns + c), i);
                 }
-                if (i == 0) break;
             }
         }
+    }
+    distribute(entries, grid.segment_cells_begin, grid.segment_items);
+    return grid;
+}
+
+template <typename Doc>
+void MapRenderer::Draw(Doc& doc, const RenderModel& model) const {
+    DrawStyle(doc);
+    DrawBusLines(doc, model, 0, model.buses.size());
+    DrawBusLabels(doc, model, 0, model.buses.size());
+    DrawStopCircles(doc, model, 0, model.stops.size());
+    DrawStopLabels(doc, model, 0, model.stops.size());
+}
 
-        doc.Add(polyline);
-        ++color_index;
+void MapRenderer::DrawMap(svg::StreamDocument& doc, const RenderModel& model, int precision) const {
+    const unsigned threads = std::thread::hardware_concurrency();
+    if (threads > 1 && 2 * (model.buses.size() + model.stops.size()) >= PARALLEL_RENDER_MIN_OBJECTS) {
+        DrawParallel(doc, model, precision, threads);
+    } else {
+        Draw(doc, model);
     }
+    doc.Finish();
 }
 
-void MapRenderer::DrawBusLabels(svg::Document& doc, const TransportCatalogue& db,
-                               const std::vector<const Bus*>& sorted_buses,
-                               const SphereProjector& projector) const {
-    size_t color_index = 0;
-    
-    for (const auto* bus : sorted_buses) {
-        if (bus->stops.empty()) continue;
-        svg::Color bus_color = settings_.color_palette[color_index % settings_.color_palette.size()];
-        std::vector<const Stop*> terminal_stops;
-        if (bus->is_roundtrip) {
-            const Stop* first_stop = db.FindStop(bus->stops[0]);
-            if (first_stop) terminal_stops.push_back(first_stop);
-        } else {
-            const Stop* first_stop = db.FindStop(bus->stops[0]);
-            const Stop* last_stop = db.FindStop(bus->stops.back());
-            if (first_stop) terminal_stops.push_back(first_stop);
-            if (last_stop && last_stop != first_stop) terminal_stops.push_back(last_stop);
-        }
-        for (const Stop* terminal_stop : terminal_stops) {
-            svg::Point pos = projector({terminal_stop->lat, terminal_stop->lng});
-            svg::Text underlayer;
-            underlayer.SetPosition(pos)
-                      .SetOffset(settings_.bus_label_offset)
-                      .SetFontSize(settings_.bus_label_font_size)
-                      .SetFontFamily("Verdana")
-                      .SetFontWeight("bold")
-                      .SetData(bus->name)
-                      .SetFillColor(settings_.underlayer_color)
-                      .SetStrokeColor(settings_.underlayer_color)
-                      .SetStrokeWidth(settings_.underlayer_width)
-                      .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
-                      .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-            doc.Add(underlayer);
-            svg::Text text;
-            text.SetPosition(pos)
-                .SetOffset(settings_.bus_label_offset)
-                .SetFontSize(settings_.bus_label_font_size)
-                .SetFontFamily("Verdana")
-                .SetFontWeight("bold")
-                .SetData(bus->name)
-                .SetFillColor(bus_color);
-            doc.Add(text);
-        }
-        ++color_index;
+template <typename Doc>
+void MapRenderer::DrawChunk(Doc& doc, const RenderModel& model, const LayerChunk& chunk) const {
+    switch (chunk.layer) {
+    case Layer::BUS_LINES:
+        DrawBusLines(doc, model, chunk.begin, chunk.end);
+        break;
+    case Layer::BUS_LABELS:
+        DrawBusLabels(doc, model, chunk.begin, chunk.end);
+        break;
+    case Layer::STOP_CIRCLES:
+        DrawStopCircles(doc, model, chunk.begin, chunk.end);
+        break;
+    case Layer::STOP_LABELS:
+        DrawStopLabels(doc, model, chunk.begin, chunk.end);
+        break;
     }
 }
 
-std::vector<const Stop*> MapRenderer::CollectStopsToRender(const TransportCatalogue& db, const std::deque<Bus>& buses) const {
-    std::set<std::string_view> stops_with_buses;
-    for (const auto& bus : buses) {
-        for (const auto& stop_name : bus.stops) {
-            stops_with_buses.insert(stop_name);
+void MapRenderer::DrawParallel(svg::StreamDocument& doc, const RenderModel& model, int precision,
+                               unsigned threads) const {
+    const size_t total = 2 * (model.buses.size() + model.stops.size());
+    const size_t chunk_size = std::max<size_t>(1, total / (threads * CHUNKS_PER_THREAD));
+    std::vector<LayerChunk> chunks;
+    auto split = [&chunks, chunk_size](Layer layer, size_t size) {
+        for (size_t begin = 0; begin < size; begin += chunk_size) {
+            chunks.push_back({layer, begin, std::min(size, begin + chunk_size)});
+        }
+    };
+    split(Layer::BUS_LINES, model.buses.size());
+    split(Layer::BUS_LABELS, model.buses.size());
+    split(Layer::STOP_CIRCLES, model.stops.size());
+    split(Layer::STOP_LABELS, model.stops.size());
+
+    // Потоки разбирают части по очереди; у каждого свой форматтер чисел с той же точностью
+    std::vector<std::string> parts(chunks.size());
+    std::atomic<size_t> next_chunk{0};
+    auto work = [&]() {
+        NumberFormatter numbers(precision);
+        for (size_t i = next_chunk++; i < chunks.size(); i = next_chunk++) {
+            std::ostringstream out;
+            svg::StreamFragment fragment(out, numbers);
+            DrawChunk(fragment, model, chunks[i]);
+            parts[i] = out.str();
         }
+    };
+    std::vector<std::future<void>> workers;
+    const size_t worker_count = std::min<size_t>(threads, chunks.size());
+    for (size_t i = 1; i < worker_count; ++i) {
+        workers.push_back(std::async(std::launch::async, work));
     }
-    std::vector<const Stop*> stops_to_render;
-    for (std::string_view stop_name : stops_with_buses) {
-        const Stop* stop = db.FindStop(stop_name);
-        if (stop) stops_to_render.push_back(stop);
+    work();
+    for (auto& worker : workers) {
+        worker.get();
     }
-    std::sort(stops_to_render.begin(), stops_to_render.end(),
-        [](const Stop* lhs, const Stop* rhs) {
-            return lhs->name < rhs->name;
+
+    DrawStyle(doc);
+    for (const std::string& part : parts) {
+        doc.AddRendered(part);
+    }
+}
+
+void MapRenderer::SetBusLabel(svg::Text& underlayer, svg::Text& text, svg::Point pos,
+                              std::string_view name, size_t color_index) const {
+    underlayer.SetPosition(pos)
+              .SetOffset(settings_.bus_label_offset)
+              .SetFontSize(settings_.bus_label_font_size)
+              .SetData(name);
+    text.SetPosition(pos)
+        .SetOffset(settings_.bus_label_offset)
+        .SetFontSize(settings_.bus_label_font_size)
+        .SetData(name)
+        .SetFillColor(settings_.color_palette[color_index % settings_.color_palette.size()]);
+    if (settings_.compact_svg) {
+        underlayer.SetClass(BUS_UNDERLAYER_CLASSES);
+        text.SetClass(BUS_LABEL_CLASS);
+        return;
+    }
+    underlayer.SetFontFamily("Verdana")
+              .SetFontWeight("bold")
+              .SetFillColor(settings_.underlayer_color)
+              .SetStrokeColor(settings_.underlayer_color)
+              .SetStrokeWidth(settings_.underlayer_width)
+              .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
+              .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+    text.SetFontFamily("Verdana")
+        .SetFontWeight("bold");
+}
+
+void MapRenderer::SetStopCircle(svg::Circle& circle, svg::Point pos) const {
+    circle.SetCenter(pos)
+          .SetRadius(settings_.stop_radius)
+          .SetFillColor("white");
+}
+
+void MapRenderer::SetStopLabel(svg::Text& underlayer, svg::Text& text, svg::Point pos,
+                               std::string_view name) const {
+    underlayer.SetPosition(pos)
+              .SetOffset(settings_.stop_label_offset)
+              .SetFontSize(settings_.stop_label_font_size)
+              .SetData(name);
+    text.SetPosition(pos)
+        .SetOffset(settings_.stop_label_offset)
+        .SetFontSize(settings_.stop_label_font_size)
+        .SetData(name)
+        .SetFillColor("black");
+    if (settings_.compact_svg) {
+        underlayer.SetClass(STOP_UNDERLAYER_CLASSES);
+        text.SetClass(STOP_LABEL_CLASS);
+        return;
+    }
+    underlayer.SetFontFamily("Verdana")
+              .SetFillColor(settings_.underlayer_color)
+              .SetStrokeColor(settings_.underlayer_color)
+              .SetStrokeWidth(settings_.underlayer_width)
+              .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
+              .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+    text.SetFontFamily("Verdana");
+}
+
+template <typename Doc>
+void MapRenderer::DrawBusLines(Doc& doc, const RenderModel& model, size_t begin, size_t end) const {
+    WithBusLineShape([&](auto& shape) {
+        for (size_t bus = begin; bus < end; ++bus) {
+            const auto& line = model.buses[bus];
+            SetBusLineStyle(shape, line.color_index);
+            for (uint32_t i = line.polyline_begin; i < line.polyline_end; ++i) {
+                shape.AddPoint(model.points[model.polyline_points[i]]);
+            }
+            doc.Add(shape);
         }
-    );
-    return stops_to_render;
+    });
 }
 
-void MapRenderer::DrawStopCircles(svg::Document& doc, const std::vector<const Stop*>& stops_to_render,
-                                 const SphereProjector& projector) const {
-    for (const Stop* stop : stops_to_render) {
-        svg::Circle circle;
-        circle.SetCenter(projector({stop->lat, stop->lng}))
-              .SetRadius(settings_.stop_radius)
-              .SetFillColor("white");
+template <typename Doc>
+void MapRenderer::DrawBusLabels(Doc& doc, const RenderModel& model, size_t begin, size_t end) const {
+    svg::Text underlayer;
+    svg::Text text;
+    for (size_t bus = begin; bus < end; ++bus) {
+        const auto& line = model.buses[bus];
+        for (uint32_t i = line.terminals_begin; i < line.terminals_end; ++i) {
+            SetBusLabel(underlayer, text, model.points[model.terminal_points[i]], line.name, line.color_index);
+            doc.Add(underlayer);
+            doc.Add(text);
+        }
+    }
+}
+
+template <typename Doc>
+void MapRenderer::DrawStopCircles(Doc& doc, const RenderModel& model, size_t begin, size_t end) const {
+    svg::Circle circle;
+    for (size_t i = begin; i < end; ++i) {
+        SetStopCircle(circle, model.points[i]);
         doc.Add(circle);
     }
 }
 
-void MapRenderer::DrawStopLabels(svg::Document& doc, const std::vector<const Stop*>& stops_to_render,
-                                const SphereProjector& projector) const {
-    for (const Stop* stop : stops_to_render) {
-        svg::Point pos = projector({stop->lat, stop->lng});
-        svg::Text underlayer;
-        underlayer.SetPosition(pos)
-                  .SetOffset(settings_.stop_label_offset)
-                  .SetFontSize(settings_.stop_label_font_size)
-                  .SetFontFamily("Verdana")
-                  .SetData(stop->name)
-                  .SetFillColor(settings_.underlayer_color)
-                  .SetStrokeColor(settings_.underlayer_color)
-                  .SetStrokeWidth(settings_.underlayer_width)
-                  .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
-                  .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+template <typename Doc>
+void MapRenderer::DrawStopLabels(Doc& doc, const RenderModel& model, size_t begin, size_t end) const {
+    svg::Text underlayer;
+    svg::Text text;
+    for (size_t i = begin; i < end; ++i) {
+        SetStopLabel(underlayer, text, model.points[i], model.stops[i]->name);
         doc.Add(underlayer);
-        svg::Text text;
-        text.SetPosition(pos)
-            .SetOffset(settings_.stop_label_offset)
-            .SetFontSize(settings_.stop_label_font_size)
-            .SetFontFamily("Verdana")
-            .SetData(stop->name)
-            .SetFillColor("black");
         doc.Add(text);
     }
 }
 
+void MapRenderer::DrawViewport(svg::StreamDocument& doc, const RenderModel& model, const Viewport& area) const {
+    DrawStyle(doc);
+    const GeometryGrid& grid = GetGrid(model);
+    std::vector<uint32_t> stops;
+    std::vector<uint32_t> segments;
+    if (!model.points.empty()) {
+        auto cell_range = [&grid](double from, double to, double origin, size_t count) {
+            const double first = std::floor((from - origin) / grid.cell_size);
+            const double last = std::floor((to - origin) / grid.cell_size);
+            return std::make_pair(static_cast<size_t>(std::clamp(first, 0.0, static_cast<double>(count))),
+                                  static_cast<size_t>(std::clamp(last + 1, 0.0, static_cast<double>(count))));
+        };
+        const auto [first_column, end_column] = cell_range(area.min_x, area.max_x, grid.min_x, grid.columns);
+        const auto [first_row, end_row] = cell_range(area.min_y, area.max_y, grid.min_y, grid.rows);
+        for (size_t r = first_row; r < end_row; ++r) {
+            for (size_t c = first_column; c < end_column; ++c) {
+                const size_t cell = r * grid.columns + c;
+                for (uint32_t i = grid.stop_cells_begin[cell]; i < grid.stop_cells_begin[cell + 1]; ++i) {
+                    if (Contains(area, model.points[grid.stop_items[i]])) {
+                        stops.push_back(grid.stop_items[i]);
+                    }
+                }
+                segments.insert(segments.end(), grid.segment_items.begin() + grid.segment_cells_begin[cell],
+                                grid.segment_items.begin() + grid.segment_cells_begin[cell + 1]);
+            }
+        }
+    }
+    // Возрастание номеров сохраняет порядок фигур полной карты
+    std::sort(stops.begin(), stops.end());
+    std::sort(segments.begin(), segments.end());
+    segments.erase(std::unique(segments.begin(), segments.end()), segments.end());
+
+    // Подряд идущие необрезанные отрезки одного маршрута образуют одну ломаную.
+    // Номера отрезков соседних маршрутов не идут подряд: последняя вершина
+    // маршрута не начинает отрезка
+    WithBusLineShape([&](auto& shape) {
+        bool shape_open = false;
+        uint32_t previous_segment = 0;
+        double previous_end = 0.0;
+        size_t bus = 0;
+        for (uint32_t segment : segments) {
+            while (segment >= model.buses[bus].polyline_end) {
+                ++bus;
+            }
+            const svg::Point& from = model.points[model.polyline_points[segment]];
+            const svg::Point& to = model.points[model.polyline_points[segment + 1]];
+            const auto clip = ClipSegment(from, to, area);
+            if (!clip) continue;
+
+            const bool continues = shape_open && segment == previous_segment + 1
+                                && previous_end == 1.0 && clip->first == 0.0;
+            if (!continues) {
+                if (shape_open) {
+                    doc.Add(shape);
+                }
+                SetBusLineStyle(shape, model.buses[bus].color_index);
+                shape.AddPoint(Interpolate(from, to, clip->first));
+                shape_open = true;
+            }
+            shape.AddPoint(Interpolate(from, to, clip->second));
+            previous_segment = segment;
+            previous_end = clip->second;
+        }
+        if (shape_open) {
+            doc.Add(shape);
+        }
+    });
+
+    svg::Text underlayer;
+    svg::Text text;
+    for (const auto& line : model.buses) {
+        for (uint32_t i = line.terminals_begin; i < line.terminals_end; ++i) {
+            if (!std::binary_search(stops.begin(), stops.end(), model.terminal_points[i])) continue;
+            SetBusLabel(underlayer, text, model.points[model.terminal_points[i]], line.name, line.color_index);
+            doc.Add(underlayer);
+            doc.Add(text);
+        }
+    }
+
+    svg::Circle circle;
+    for (uint32_t stop : stops) {
+        SetStopCircle(circle, model.points[stop]);
+        doc.Add(circle);
+    }
+    svg::Text stop_underlayer;
+    svg::Text stop_text;
+    for (uint32_t stop : stops) {
+        SetStopLabel(stop_underlayer, stop_text, model.points[stop], model.stops[stop]->name);
+        doc.Add(stop_underlayer);
+        doc.Add(stop_text);
+    }
+}
+
+void MapRenderer::DrawRouteOverlay(svg::StreamFragment& fragment, const TransportCatalogue& db,
+                                   const RenderModel& model, const RouteInfo& route) const {
+    // Остановки и автобусы модели упорядочены по названию
+    auto find_stop = [&model](std::string_view name) -> std::optional<size_t> {
+        auto it = std::lower_bound(model.stops.begin(), model.stops.end(), name,
+            [](const Stop* stop, std::string_view name) {
+                return stop->name < name;
+            });
+        if (it == model.stops.end() || (*it)->name != name) {
+            return std::nullopt;
+        }
+        return static_cast<size_t>(it - model.stops.begin());
+    };
+    auto find_color = [&model](std::string_view name) {
+        auto it = std::lower_bound(model.buses.begin(), model.buses.end(), name,
+            [](const RenderModel::BusLine& line, std::string_view name) {
+                return line.name < name;
+            });
+        return it != model.buses.end() && it->name == name ? it->color_index : 0;
+    };
+
+    struct Ride {
+        size_t color_index;
+        std::vector<svg::Point> points;
+    };
+    std::vector<Ride> rides;
+    // Остановки, где пассажир садится в автобус, и конечная остановка маршрута
+    std::vector<size_t> marked_stops;
+    for (const RouteItem& item : route.items) {
+        if (item.type == RouteItem::Type::Wait) {
+            if (auto stop = find_stop(item.stop_name)) {
+                marked_stops.push_back(*stop);
+            }
+            continue;
+        }
+        const Bus* bus = db.FindBus(item.bus);
+        if (!bus) continue;
+
+        Ride ride{find_color(item.bus), {}};
+        std::optional<size_t> last_stop;
+        for (int k = 0; k <= item.span_count; ++k) {
+            const size_t index = item.backward ? item.first_stop_index - k : item.first_stop_index + k;
+            if (index >= bus->stops.size()) break;
+            if ((last_stop = find_stop(bus->stops[index]))) {
+                ride.points.push_back(model.points[*last_stop]);
+            }
+        }
+        rides.push_back(std::move(ride));
+        if (&item == &route.items.back() && last_stop) {
+            marked_stops.push_back(*last_stop);
+        }
+    }
+
+    WithBusLineShape([&](auto& shape) {
+        for (const Ride& ride : rides) {
+            SetRouteHaloStyle(shape);
+            for (const svg::Point& point : ride.points) {
+                shape.AddPoint(point);
+            }
+            fragment.Add(shape);
+        }
+    });
+    WithBusLineShape([&](auto& shape) {
+        for (const Ride& ride : rides) {
+            SetBusLineStyle(shape, ride.color_index);
+            for (const svg::Point& point : ride.points) {
+                shape.AddPoint(point);
+            }
+            fragment.Add(shape);
+        }
+    });
+
+    svg::Circle circle;
+    for (size_t stop : marked_stops) {
+        SetStopCircle(circle, model.points[stop]);
+        circle.SetStrokeColor("black")
+              .SetStrokeWidth(settings_.stop_radius / 2);
+        fragment.Add(circle);
+    }
+    svg::Text underlayer;
+    svg::Text text;
+    for (size_t stop : marked_stops) {
+        SetStopLabel(underlayer, text, model.points[stop], model.stops[stop]->name);
+        fragment.Add(underlayer);
+        fragment.Add(text);
+    }
+}
+
 }  // namespace renderer
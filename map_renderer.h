@@ -2,10 +2,14 @@
 
 #include "svg.h"
 #include "transport_catalogue.h"
+#include "transport_router.h"
+#include <cstdint>
+#include <optional>
 #include <string>
 #include <vector>
+#include <string_view>
+#include <utility>
 #include <variant>
-#include <deque>
 
 struct RenderSettings {
     double width = 0.0;
@@ -25,32 +29,173 @@ struct RenderSettings {
     double underlayer_width = 0.0;
 
     std::vector<svg::Color> color_palette;
+
+    // Допуск упрощения ломаных маршрутов в единицах карты (алгоритм Дугласа - Пекера):
+    // промежуточная вершина отбрасывается, если отстоит от упрощённой ломаной не
+    // дальше чем на него. При 0 ломаные выводятся без изменений
+    double simplify_tolerance = 0.0;
+
+    // Компактный вывод: общие свойства линий и подписей задаются классами в элементе
+    // style, линии маршрутов выводятся элементами path с относительными координатами,
+    // округлёнными до compact_svg_decimals знаков после запятой
+    bool compact_svg = false;
+    int compact_svg_decimals = 2;
 };
 
 namespace renderer {
 
-class SphereProjector;
+// Прямоугольная область в координатах карты
+struct Viewport {
+    double min_x = 0.0;
+    double min_y = 0.0;
+    double max_x = 0.0;
+    double max_y = 0.0;
+};
 
 class MapRenderer {
 public:
     explicit MapRenderer(const RenderSettings& settings);
 
     svg::Document RenderMap(const TransportCatalogue& db) const;
+    // Выводит карту в doc по мере отрисовки, не создавая объектов в куче
+    void RenderMap(const TransportCatalogue& db, svg::StreamDocument& doc) const;
+    // Текст SVG-документа карты. Настройки отрисовки у объекта неизменны, поэтому
+    // результат кешируется по версии справочника и точности чисел: повторный вызов
+    // для неизменившегося справочника возвращает ту же строку без отрисовки.
+    // Ссылка действительна до следующего вызова; метод не потокобезопасен
+    const std::string& RenderMapText(const TransportCatalogue& db, NumberFormatter& numbers) const;
+    // Выводит текст карты в out. Карта версии справочника, которой нет в кеше,
+    // выводится в out по мере отрисовки, а копия текста сохраняется в тот же кеш,
+    // что и у RenderMapText, поэтому повторный запрос карту не перерисовывает
+    void RenderMap(const TransportCatalogue& db, std::ostream& out, NumberFormatter& numbers) const;
+
+    // Карта с выделенным маршрутом route: поверх кешированной карты города выводятся
+    // поездки маршрута на подложке цвета underlayer_color, а затем остановки посадки,
+    // пересадки и прибытия с подписями. Для каждого маршрута рисуется только это наложение
+    void RenderRouteMap(const TransportCatalogue& db, const RouteInfo& route, std::ostream& out,
+                        NumberFormatter& numbers) const;
+
+    // Область тайла (x, y) уровня zoom: карта делится на 2^zoom x 2^zoom равных частей,
+    // тайл (0, 0) - левый верхний
+    Viewport GetTileViewport(int zoom, int x, int y) const;
+    // Выводит только фигуры, задевающие viewport, в координатах всей карты. Ломаные
+    // обрезаются по границе области, расширенной на толщину линии; остановка и её
+    // подписи выводятся, если в расширенную область попадает сама остановка
+    void RenderViewport(const TransportCatalogue& db, const Viewport& viewport, svg::StreamDocument& doc) const;
 
 private:
-    void DrawBusLines(svg::Document& doc, const TransportCatalogue& db, 
-                     const std::vector<const Bus*>& sorted_buses,
-                     const SphereProjector& projector) const;
-    void DrawBusLabels(svg::Document& doc, const TransportCatalogue& db, 
-                      const std::vector<const Bus*>& sorted_buses,
-                      const SphereProjector& projector) const;
-    std::vector<const Stop*> CollectStopsToRender(const TransportCatalogue& db, const std::deque<Bus>& buses) const;
-    void DrawStopCircles(svg::Document& doc, const std::vector<const Stop*>& stops_to_render,
-                        const SphereProjector& projector) const;
-    void DrawStopLabels(svg::Document& doc, const std::vector<const Stop*>& stops_to_render,
-                       const SphereProjector& projector) const;
+    // Всё, что нужно для отрисовки карты, в виде плоских массивов. Строится один раз
+    // для версии справочника, после чего слои рисуются без поиска остановок по имени
+    struct RenderModel {
+        struct BusLine {
+            std::string_view name;
+            // Номер цвета в палитре
+            size_t color_index;
+            // Вершины ломаной маршрута и конечные остановки - диапазоны в
+            // polyline_points и terminal_points
+            uint32_t polyline_begin;
+            uint32_t polyline_end;
+            uint32_t terminals_begin;
+            uint32_t terminals_end;
+        };
+
+        uint64_t catalogue_version = 0;
+        // Остановки, через которые проходят автобусы, по возрастанию названия,
+        // и их координаты на карте под теми же номерами
+        std::vector<const Stop*> stops;
+        std::vector<svg::Point> points;
+        // Автобусы с непустым маршрутом по возрастанию названия
+        std::vector<BusLine> buses;
+        // Номера остановок в stops
+        std::vector<uint32_t> polyline_points;
+        std::vector<uint32_t> terminal_points;
+    };
+
+    // Равномерная сетка над координатами модели. Для каждой ячейки хранятся номера
+    // остановок и отрезков ломаных, чьи габариты её задевают. Отрезок с номером i
+    // соединяет вершины i и i + 1 в polyline_points
+    struct GeometryGrid {
+        uint64_t catalogue_version = 0;
+        double min_x = 0.0;
+        double min_y = 0.0;
+        double cell_size = 1.0;
+        size_t columns = 0;
+        size_t rows = 0;
+        // Содержимое ячейки c - диапазон [cells_begin[c], cells_begin[c + 1])
+        std::vector<uint32_t> stop_cells_begin;
+        std::vector<uint32_t> stop_items;
+        std::vector<uint32_t> segment_cells_begin;
+        std::vector<uint32_t> segment_items;
+    };
+
+    const RenderModel& GetModel(const TransportCatalogue& db) const;
+    RenderModel BuildModel(const TransportCatalogue& db) const;
+    // Сетка строится при первом запросе области и кешируется вместе с моделью
+    const GeometryGrid& GetGrid(const RenderModel& model) const;
+    GeometryGrid BuildGrid(const RenderModel& model) const;
+
+    // Слои карты в порядке вывода
+    enum class Layer { BUS_LINES, BUS_LABELS, STOP_CIRCLES, STOP_LABELS };
+
+    // Часть слоя: автобусы или остановки модели с номерами [begin, end)
+    struct LayerChunk {
+        Layer layer;
+        size_t begin;
+        size_t end;
+    };
+
+    // Doc - svg::Document, svg::StreamDocument или svg::StreamFragment. Объекты каждого
+    // слоя переиспользуются между итерациями, чтобы не выделять память под каждую фигуру
+    template <typename Doc>
+    void Draw(Doc& doc, const RenderModel& model) const;
+    // Рисует всю карту и завершает документ; большие карты - в нескольких потоках
+    void DrawMap(svg::StreamDocument& doc, const RenderModel& model, int precision) const;
+    template <typename Doc>
+    void DrawChunk(Doc& doc, const RenderModel& model, const LayerChunk& chunk) const;
+    template <typename Doc>
+    void DrawBusLines(Doc& doc, const RenderModel& model, size_t begin, size_t end) const;
+    template <typename Doc>
+    void DrawBusLabels(Doc& doc, const RenderModel& model, size_t begin, size_t end) const;
+    template <typename Doc>
+    void DrawStopCircles(Doc& doc, const RenderModel& model, size_t begin, size_t end) const;
+    template <typename Doc>
+    void DrawStopLabels(Doc& doc, const RenderModel& model, size_t begin, size_t end) const;
+    // Рисует слои частями в threads потоках, каждую часть - в свой буфер, и
+    // добавляет буферы в doc в порядке слоёв. Результат совпадает с Draw
+    void DrawParallel(svg::StreamDocument& doc, const RenderModel& model, int precision, unsigned threads) const;
+    void DrawViewport(svg::StreamDocument& doc, const RenderModel& model, const Viewport& area) const;
+    void DrawRouteOverlay(svg::StreamFragment& fragment, const TransportCatalogue& db,
+                          const RenderModel& model, const RouteInfo& route) const;
+
+    // Элемент style с классами компактного режима; в обычном режиме ничего не выводит
+    template <typename Doc>
+    void DrawStyle(Doc& doc) const;
+    // Вызывает draw с переиспользуемой фигурой для линий маршрутов: svg::Path в
+    // компактном режиме, иначе svg::Polyline
+    template <typename Callback>
+    void WithBusLineShape(Callback&& draw) const;
+
+    // Настраивают переиспользуемые объекты для очередной фигуры
+    template <typename Line>
+    void SetBusLineStyle(Line& line, size_t color_index) const;
+    // Подложка линии маршрута на карте с выделенным маршрутом
+    template <typename Line>
+    void SetRouteHaloStyle(Line& line) const;
+    void SetBusLabel(svg::Text& underlayer, svg::Text& text, svg::Point pos,
+                     std::string_view name, size_t color_index) const;
+    void SetStopCircle(svg::Circle& circle, svg::Point pos) const;
+    void SetStopLabel(svg::Text& underlayer, svg::Text& text, svg::Point pos, std::string_view name) const;
     
     RenderSettings settings_;
+    mutable std::optional<RenderModel> model_;
+    mutable std::optional<GeometryGrid> grid_;
+
+    struct CachedMap {
+        uint64_t catalogue_version = 0;
+        int precision = 0;
+        std::string text;
+    };
+    mutable std::optional<CachedMap> cache_;
 };
 
 }  // namespace renderer
\ No newline at end of file
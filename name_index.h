@@ -0,0 +1,145 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Неизменяемый индекс "имя -> объект" на основе минимальной совершенной хеш-функции
+// (схема hash-and-displace). Строится один раз после загрузки данных, после чего поиск
+// выполняет два хеширования, одно обращение к таблице смещений и одно сравнение строк.
+template <typename T>
+class FrozenNameIndex {
+public:
+    using Entry = std::pair<std::string_view, const T*>;
+
+    FrozenNameIndex() = default;
+
+    // Имена в entries должны быть уникальны и жить дольше индекса
+    void Build(std::vector<Entry> entries) {
+        slots_.clear();
+        seeds_.clear();
+        sorted_.clear();
+        bucket_count_ = 0;
+        if (entries.empty()) {
+            return;
+        }
+
+        // Если для какой-то корзины затравка не нашлась, увеличиваем таблицу: свободных
+        // слотов становится больше, и подбор сходится быстрее
+        size_t slot_count = entries.size();
+        for (int attempt = 0; attempt < MAX_TABLE_GROWTHS; ++attempt) {
+            if (TryBuild(entries, slot_count)) {
+                return;
+            }
+            slot_count += slot_count / 4 + 1;
+        }
+
+        // Совершенную функцию подобрать не удалось - ищем двоичным поиском
+        slots_.clear();
+        seeds_.clear();
+        bucket_count_ = 0;
+        std::sort(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs) {
+            return lhs.first < rhs.first;
+        });
+        sorted_ = std::move(entries);
+    }
+
+    const T* Find(std::string_view name) const {
+        if (!sorted_.empty()) {
+            auto it = std::lower_bound(sorted_.begin(), sorted_.end(), name, [](const Entry& entry, std::string_view key) {
+                return entry.first < key;
+            });
+            return it != sorted_.end() && it->first == name ? it->second : nullptr;
+        }
+        if (slots_.empty()) {
+            return nullptr;
+        }
+        const uint32_t seed = seeds_[Hash(name, 0) % bucket_count_];
+        const Entry& entry = slots_[Hash(name, seed) % slots_.size()];
+        return entry.first == name ? entry.second : nullptr;
+    }
+
+private:
+    static constexpr size_t BUCKET_SIZE = 4;
+    // Ограничения подбора: число затравок на корзину (в расчёте на слот таблицы)
+    // и число увеличений таблицы до перехода к отсортированному массиву
+    static constexpr size_t SEED_ATTEMPTS_PER_SLOT = 16;
+    static constexpr int MAX_TABLE_GROWTHS = 4;
+
+    bool TryBuild(const std::vector<Entry>& entries, size_t slot_count) {
+        slots_.assign(slot_count, Entry{});
+        bucket_count_ = (entries.size() + BUCKET_SIZE - 1) / BUCKET_SIZE;
+        seeds_.assign(bucket_count_, 0);
+
+        std::vector<std::vector<size_t>> buckets(bucket_count_);
+        for (size_t i = 0; i < entries.size(); ++i) {
+            buckets[Hash(entries[i].first, 0) % bucket_count_].push_back(i);
+        }
+
+        // Сначала размещаем самые большие корзины, пока свободных слотов много
+        std::vector<size_t> order(bucket_count_);
+        for (size_t i = 0; i < bucket_count_; ++i) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&buckets](size_t lhs, size_t rhs) {
+            return buckets[lhs].size() > buckets[rhs].size();
+        });
+
+        const uint64_t max_seed = SEED_ATTEMPTS_PER_SLOT * slot_count + 1024;
+        std::vector<bool> taken(slot_count, false);
+        std::vector<size_t> candidate;
+        for (size_t bucket : order) {
+            const auto& items = buckets[bucket];
+            if (items.empty()) {
+                break;
+            }
+            bool placed = false;
+            for (uint64_t seed = 1; seed <= max_seed && !placed; ++seed) {
+                candidate.clear();
+                bool ok = true;
+                for (size_t item : items) {
+                    const size_t slot = Hash(entries[item].first, static_cast<uint32_t>(seed)) % slot_count;
+                    if (taken[slot] || std::find(candidate.begin(), candidate.end(), slot) != candidate.end()) {
+                        ok = false;
+                        break;
+                    }
+                    candidate.push_back(slot);
+                }
+                if (!ok) {
+                    continue;
+                }
+                for (size_t i = 0; i < items.size(); ++i) {
+                    taken[candidate[i]] = true;
+                    slots_[candidate[i]] = entries[items[i]];
+                }
+                seeds_[bucket] = static_cast<uint32_t>(seed);
+                placed = true;
+            }
+            if (!placed) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // FNV-1a с примешиванием затравки и финальным перемешиванием битов
+    static uint64_t Hash(std::string_view str, uint32_t seed) {
+        uint64_t h = 14695981039346656037ULL ^ (static_cast<uint64_t>(seed) * 0x9E3779B97F4A7C15ULL);
+        for (unsigned char c : str) {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    std::vector<Entry> slots_;
+    std::vector<uint32_t> seeds_;
+    size_t bucket_count_ = 0;
+    // Запасной вариант, если совершенную функцию подобрать не удалось
+    std::vector<Entry> sorted_;
+};
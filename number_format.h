@@ -0,0 +1,52 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <ostream>
+#include <string_view>
+#include <type_traits>
+
+// Форматирует числа через std::to_chars во внутренний буфер, не обращаясь к локали
+// и состоянию потока. Один объект используется для всех чисел выводимого документа
+class NumberFormatter {
+public:
+    // Шесть значащих цифр: так числа выводит std::ostream с настройками по умолчанию
+    static constexpr int DEFAULT_PRECISION = 6;
+    // Кратчайшая запись, из которой число восстанавливается без потерь
+    static constexpr int SHORTEST = 0;
+    // Больше значащих цифр double не содержит
+    static constexpr int MAX_PRECISION = 17;
+
+    explicit NumberFormatter(int precision = DEFAULT_PRECISION)
+        : precision_(std::clamp(precision, SHORTEST, MAX_PRECISION)) {
+    }
+
+    int GetPrecision() const {
+        return precision_;
+    }
+
+    // Результат действителен до следующего вызова Format
+    std::string_view Format(double value) {
+        const auto result = precision_ == SHORTEST
+            ? std::to_chars(buffer_, buffer_ + sizeof(buffer_), value)
+            : std::to_chars(buffer_, buffer_ + sizeof(buffer_), value, std::chars_format::general, precision_);
+        return {buffer_, static_cast<size_t>(result.ptr - buffer_)};
+    }
+
+    template <typename Integer, std::enable_if_t<std::is_integral_v<Integer>, int> = 0>
+    std::string_view Format(Integer value) {
+        const auto result = std::to_chars(buffer_, buffer_ + sizeof(buffer_), value);
+        return {buffer_, static_cast<size_t>(result.ptr - buffer_)};
+    }
+
+    template <typename Number>
+    void Write(std::ostream& out, Number value) {
+        const std::string_view text = Format(value);
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+
+private:
+    int precision_;
+    // Вмещает любое число с точностью до MAX_PRECISION, включая знак и порядок
+    char buffer_[64];
+};
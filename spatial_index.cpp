@@ -0,0 +1,256 @@
+#define _USE_MATH_DEFINES
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+const double DEG_TO_RAD = M_PI / 180.0;
+const double LAT_DEGREE_M = DEG_TO_RAD * geo::EARTH_RADIUS;
+// Запас в градусах на погрешность округления при переходе от метров к ячейкам
+const double DEGREE_EPSILON = 1e-9;
+const int MAX_GRID_SIDE = 4096;
+
+// Длина градуса долготы на широте lat; используется только для выбора формы ячеек
+double LngDegreeMeters(double lat) {
+    return LAT_DEGREE_M * std::cos(std::min(std::abs(lat), 90.0) * DEG_TO_RAD);
+}
+
+// Расстояние по большому кругу от точки на широте lat до ближайшей точки, долгота
+// которой отличается не меньше чем на dlng градусов: это расстояние до плоскости
+// меридиана, а при dlng >= 90 - до ближайшего полюса
+double MeridianDistance(double lat, double dlng) {
+    const double angle = std::clamp(dlng, 0.0, 90.0) * DEG_TO_RAD;
+    return std::asin(std::min(std::cos(lat * DEG_TO_RAD) * std::sin(angle), 1.0)) * geo::EARTH_RADIUS;
+}
+
+void SortByDistance(std::vector<NearbyStop>& stops) {
+    std::sort(stops.begin(), stops.end(), [](const NearbyStop& lhs, const NearbyStop& rhs) {
+        return lhs.distance < rhs.distance
+            || (lhs.distance == rhs.distance && lhs.stop->name < rhs.stop->name);
+    });
+}
+
+}  // namespace
+
+StopsSpatialIndex::StopsSpatialIndex(const TransportCatalogue& catalogue) {
+    const auto& stops = catalogue.GetAllStops();
+    if (stops.empty()) {
+        return;
+    }
+
+    double max_lat = stops.front().lat;
+    min_lat_ = stops.front().lat;
+    min_lng_ = stops.front().lng;
+    max_lng_ = stops.front().lng;
+    for (const Stop& stop : stops) {
+        min_lat_ = std::min(min_lat_, stop.lat);
+        max_lat = std::max(max_lat, stop.lat);
+        min_lng_ = std::min(min_lng_, stop.lng);
+        max_lng_ = std::max(max_lng_, stop.lng);
+    }
+    const double max_abs_lat = std::max(std::abs(min_lat_), std::abs(max_lat));
+
+    // Подбираем сетку примерно с двумя остановками на ячейку и близкими
+    // к квадратным (в метрах) ячейками
+    const double span_lat_m = std::max((max_lat - min_lat_) * LAT_DEGREE_M, 1.0);
+    const double span_lng_m = std::max((max_lng_ - min_lng_) * LngDegreeMeters(max_abs_lat), 1.0);
+    const double target_cells = std::max(1.0, stops.size() / 2.0);
+    const double cell_side_m = std::sqrt(span_lat_m * span_lng_m / target_cells);
+    rows_ = std::clamp(static_cast<int>(std::ceil(span_lat_m / cell_side_m)), 1, MAX_GRID_SIDE);
+    cols_ = std::clamp(static_cast<int>(std::ceil(span_lng_m / cell_side_m)), 1, MAX_GRID_SIDE);
+    cell_lat_ = max_lat > min_lat_ ? (max_lat - min_lat_) / rows_ : 1.0;
+    cell_lng_ = max_lng_ > min_lng_ ? (max_lng_ - min_lng_) / cols_ : 1.0;
+
+    const size_t cell_count = static_cast<size_t>(rows_) * cols_;
+    cell_begin_.assign(cell_count + 1, 0);
+    std::vector<uint32_t> stop_cells;
+    stop_cells.reserve(stops.size());
+    for (const Stop& stop : stops) {
+        const uint32_t cell = static_cast<uint32_t>(CellRow(stop.lat)) * cols_ + CellCol(stop.lng);
+        stop_cells.push_back(cell);
+        ++cell_begin_[cell + 1];
+    }
+    for (size_t i = 1; i <= cell_count; ++i) {
+        cell_begin_[i] += cell_begin_[i - 1];
+    }
+    stops_.resize(stops.size());
+    std::vector<uint32_t> fill(cell_begin_.begin(), cell_begin_.end() - 1);
+    size_t i = 0;
+    for (const Stop& stop : stops) {
+        stops_[fill[stop_cells[i++]]++] = &stop;
+    }
+    points_.Reserve(stops_.size());
+    for (const Stop* stop : stops_) {
+        points_.Add({stop->lat, stop->lng});
+    }
+}
+
+int StopsSpatialIndex::CellRow(double lat) const {
+    return std::clamp(static_cast<int>(std::floor((lat - min_lat_) / cell_lat_)), 0, rows_ - 1);
+}
+
+int StopsSpatialIndex::CellCol(double lng) const {
+    return std::clamp(static_cast<int>(std::floor((lng - min_lng_) / cell_lng_)), 0, cols_ - 1);
+}
+
+double StopsSpatialIndex::DistanceToOutside(geo::Coordinates center, int row_min, int row_max,
+                                            int col_min, int col_max) const {
+    const double inf = std::numeric_limits<double>::infinity();
+    double result = inf;
+    // Разница широт в радианах, умноженная на радиус, не превышает расстояния по большому кругу
+    if (row_min > 0) {
+        result = std::min(result, (center.lat - (min_lat_ + row_min * cell_lat_)) * LAT_DEGREE_M);
+    }
+    if (row_max < rows_ - 1) {
+        result = std::min(result, (min_lat_ + (row_max + 1) * cell_lat_ - center.lat) * LAT_DEGREE_M);
+    }
+    // Долгота в индексе не замыкается, поэтому разница долгот до остановок за
+    // границей прямоугольника ограничена снизу и шириной полосы, и переходом через 180-й меридиан
+    if (col_min > 0) {
+        const double gap = center.lng - (min_lng_ + col_min * cell_lng_);
+        const double wrapped = 360.0 - (center.lng - min_lng_);
+        result = std::min(result, MeridianDistance(center.lat, std::min(gap, wrapped)));
+    }
+    if (col_max < cols_ - 1) {
+        const double gap = min_lng_ + (col_max + 1) * cell_lng_ - center.lng;
+        const double wrapped = 360.0 - (max_lng_ - center.lng);
+        result = std::min(result, MeridianDistance(center.lat, std::min(gap, wrapped)));
+    }
+    return std::max(result, 0.0);
+}
+
+void StopsSpatialIndex::ScanCell(int row, int col, geo::Coordinates center, double max_distance,
+                                 std::vector<double>& distances, std::vector<NearbyStop>& result) const {
+    const size_t cell = static_cast<size_t>(row) * cols_ + col;
+    const uint32_t begin = cell_begin_[cell];
+    const uint32_t count = cell_begin_[cell + 1] - begin;
+    if (count == 0) {
+        return;
+    }
+    distances.resize(count);
+    points_.ComputeDistancesFrom(center, begin, count, distances.data(), geo::DistanceFormula::HAVERSINE);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (distances[i] <= max_distance) {
+            result.push_back({stops_[begin + i], distances[i]});
+        }
+    }
+}
+
+std::vector<NearbyStop> StopsSpatialIndex::FindWithinRadius(geo::Coordinates center, double radius) const {
+    std::vector<NearbyStop> result;
+    if (stops_.empty() || radius < 0.0) {
+        return result;
+    }
+
+    const double dlat = radius / LAT_DEGREE_M + DEGREE_EPSILON;
+    const int row_min = CellRow(center.lat - dlat);
+    const int row_max = CellRow(center.lat + dlat);
+
+    // Наибольшая разница долгот точек круга: sin(dlng) = sin(radius / R) / cos(lat).
+    // Если круг накрывает полюс, подходят все долготы
+    const double angle = radius / geo::EARTH_RADIUS;
+    const double cos_lat = std::cos(center.lat * DEG_TO_RAD);
+    double dlng = 180.0;
+    if (angle < M_PI / 2 && std::sin(angle) < cos_lat) {
+        dlng = std::asin(std::sin(angle) / cos_lat) / DEG_TO_RAD + DEGREE_EPSILON;
+    }
+
+    // Круг может пересекать 180-й меридиан, поэтому проверяем его копии, сдвинутые на
+    // полный оборот, и объединяем пересекающиеся диапазоны столбцов
+    std::vector<std::pair<int, int>> col_ranges;
+    if (dlng >= 180.0) {
+        col_ranges.emplace_back(0, cols_ - 1);
+    } else {
+        for (double shift : {-360.0, 0.0, 360.0}) {
+            const double lng_min = center.lng + shift - dlng;
+            const double lng_max = center.lng + shift + dlng;
+            if (lng_max < min_lng_ || lng_min > max_lng_) {
+                continue;
+            }
+            const int col_min = CellCol(lng_min);
+            const int col_max = CellCol(lng_max);
+            if (!col_ranges.empty() && col_min <= col_ranges.back().second) {
+                col_ranges.back().second = std::max(col_ranges.back().second, col_max);
+            } else {
+                col_ranges.emplace_back(col_min, col_max);
+            }
+        }
+    }
+
+    std::vector<double> distances;
+    for (int row = row_min; row <= row_max; ++row) {
+        for (const auto& [col_min, col_max] : col_ranges) {
+            for (int col = col_min; col <= col_max; ++col) {
+                ScanCell(row, col, center, radius, distances, result);
+            }
+        }
+    }
+    SortByDistance(result);
+    return result;
+}
+
+std::vector<NearbyStop> StopsSpatialIndex::FindNearest(geo::Coordinates center, size_t count,
+                                                       double max_radius) const {
+    std::vector<NearbyStop> result;
+    if (stops_.empty() || count == 0) {
+        return result;
+    }
+
+    auto keep_best = [&result, count] {
+        if (result.size() > count) {
+            std::nth_element(result.begin(), result.begin() + (count - 1), result.end(),
+                [](const NearbyStop& lhs, const NearbyStop& rhs) {
+                    return lhs.distance < rhs.distance;
+                });
+            // Сохраняем всех, кто равноудалён с последним, чтобы порядок по имени был детерминирован
+            const double kth = result[count - 1].distance;
+            result.erase(std::partition(result.begin(), result.end(),
+                [kth](const NearbyStop& item) { return item.distance <= kth; }), result.end());
+        }
+    };
+
+    // Обходим кольца ячеек вокруг ячейки центра, пока следующее кольцо
+    // гарантированно не может содержать более близких остановок
+    const int center_row = CellRow(center.lat);
+    const int center_col = CellCol(center.lng);
+    const int max_ring = std::max(rows_, cols_);
+    std::vector<double> distances;
+    for (int ring = 0; ring <= max_ring; ++ring) {
+        const int row_min = center_row - ring;
+        const int row_max = center_row + ring;
+        const int col_min = center_col - ring;
+        const int col_max = center_col + ring;
+        for (int row = std::max(row_min, 0); row <= std::min(row_max, rows_ - 1); ++row) {
+            const bool edge_row = row == row_min || row == row_max;
+            for (int col = std::max(col_min, 0); col <= std::min(col_max, cols_ - 1); ++col) {
+                if (edge_row || col == col_min || col == col_max) {
+                    ScanCell(row, col, center, max_radius, distances, result);
+                }
+            }
+        }
+        keep_best();
+
+        const double outside = DistanceToOutside(center, row_min, row_max, col_min, col_max);
+        if (outside > max_radius) {
+            break;
+        }
+        if (result.size() >= count) {
+            const double kth = std::max_element(result.begin(), result.end(),
+                [](const NearbyStop& lhs, const NearbyStop& rhs) {
+                    return lhs.distance < rhs.distance;
+                })->distance;
+            if (outside > kth) {
+                break;
+            }
+        }
+    }
+
+    SortByDistance(result);
+    if (result.size() > count) {
+        result.resize(count);
+    }
+    return result;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "geo.h"
+#include "transport_catalogue.h"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+struct NearbyStop {
+    const Stop* stop;
+    double distance;
+};
+
+// Равномерная сетка по координатам остановок. Ячейки хранятся в плотном массиве:
+// остановки ячейки c лежат в stops_[cell_begin_[c], cell_begin_[c + 1]), а их
+// предвычисленные координаты - в points_ под теми же индексами. Расстояния
+// считаются по формуле гаверсинуса, устойчивой для совпадающих точек
+class StopsSpatialIndex {
+public:
+    explicit StopsSpatialIndex(const TransportCatalogue& catalogue);
+
+    // Остановки не дальше radius метров от center, по возрастанию расстояния
+    std::vector<NearbyStop> FindWithinRadius(geo::Coordinates center, double radius) const;
+
+    // Не более count ближайших к center остановок, но не дальше max_radius метров
+    std::vector<NearbyStop> FindNearest(geo::Coordinates center, size_t count,
+                                        double max_radius = std::numeric_limits<double>::infinity()) const;
+
+private:
+    int CellRow(double lat) const;
+    int CellCol(double lng) const;
+    // Нижняя оценка расстояния в метрах от center до любой точки вне
+    // прямоугольника ячеек [row_min, row_max] x [col_min, col_max]
+    double DistanceToOutside(geo::Coordinates center, int row_min, int row_max,
+                             int col_min, int col_max) const;
+    void ScanCell(int row, int col, geo::Coordinates center, double max_distance,
+                  std::vector<double>& distances, std::vector<NearbyStop>& result) const;
+
+    double min_lat_ = 0.0;
+    double min_lng_ = 0.0;
+    double max_lng_ = 0.0;
+    double cell_lat_ = 1.0;
+    double cell_lng_ = 1.0;
+    int rows_ = 0;
+    int cols_ = 0;
+    std::vector<uint32_t> cell_begin_;
+    std::vector<const Stop*> stops_;
+    geo::PrecomputedPoints points_;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+// Пул строк, в который можно только добавлять. Каждая строка хранится в единственном
+// экземпляре, а наружу выдаются string_view, действительные всё время жизни пула.
+class StringArena {
+public:
+    StringArena() = default;
+    StringArena(const StringArena&) = delete;
+    StringArena& operator=(const StringArena&) = delete;
+
+    std::string_view Intern(std::string_view str) {
+        if (auto it = interned_.find(str); it != interned_.end()) {
+            return *it;
+        }
+        std::string_view stored = Store(str);
+        interned_.insert(stored);
+        return stored;
+    }
+
+    // Освобождает таблицу поиска дубликатов. Уже выданные строки остаются
+    // действительными, но повторный Intern той же строки создаст новую копию
+    void DropLookup() {
+        std::unordered_set<std::string_view>{}.swap(interned_);
+    }
+
+    size_t GetBytesUsed() const {
+        return bytes_used_;
+    }
+
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    std::string_view Store(std::string_view str) {
+        if (str.empty()) {
+            return {};
+        }
+        if (str.size() > BLOCK_SIZE / 4) {
+            // Длинные строки получают собственный блок, чтобы не дробить общие
+            blocks_.push_back(std::make_unique<char[]>(str.size()));
+            std::memcpy(blocks_.back().get(), str.data(), str.size());
+            bytes_used_ += str.size();
+            return {blocks_.back().get(), str.size()};
+        }
+        if (!current_ || current_free_ < str.size()) {
+            blocks_.push_back(std::make_unique<char[]>(BLOCK_SIZE));
+            current_ = blocks_.back().get();
+            current_free_ = BLOCK_SIZE;
+        }
+        char* dest = current_;
+        std::memcpy(dest, str.data(), str.size());
+        current_ += str.size();
+        current_free_ -= str.size();
+        bytes_used_ += str.size();
+        return {dest, str.size()};
+    }
+
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char* current_ = nullptr;
+    size_t current_free_ = 0;
+    size_t bytes_used_ = 0;
+    std::unordered_set<std::string_view> interned_;
+};
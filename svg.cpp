@@ -1,40 +1,80 @@
 #include "svg.h"
 
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+
 namespace svg {
 
     using namespace std::literals;
 
     namespace {
 
-        void RenderColor(std::ostream& out, std::monostate) {
-            out << "none"s;
+        void RenderColorValue(const RenderContext& context, std::monostate) {
+            context.out << "none"s;
         }
 
-        void RenderColor(std::ostream& out, const std::string& value) {
-            out << value;
+        void RenderColorValue(const RenderContext& context, const std::string& value) {
+            context.out << value;
         }
 
-        void RenderColor(std::ostream& out, Rgb rgb) {
-            out << "rgb("sv << static_cast<int>(rgb.red)  
-                << ',' << static_cast<int>(rgb.green)     
-                << ',' << static_cast<int>(rgb.blue) << ')';
+        void RenderColorValue(const RenderContext& context, Rgb rgb) {
+            context.out << "rgb("sv;
+            context.RenderNumber(static_cast<int>(rgb.red));
+            context.out.put(',');
+            context.RenderNumber(static_cast<int>(rgb.green));
+            context.out.put(',');
+            context.RenderNumber(static_cast<int>(rgb.blue));
+            context.out.put(')');
         }
 
-        void RenderColor(std::ostream& out, Rgba rgba) {
-            out << "rgba("sv << static_cast<int>(rgba.red)  
-                << ',' << static_cast<int>(rgba.green)      
-                << ',' << static_cast<int>(rgba.blue)       
-                << ',' << rgba.opacity << ')';
+        void RenderColorValue(const RenderContext& context, Rgba rgba) {
+            context.out << "rgba("sv;
+            context.RenderNumber(static_cast<int>(rgba.red));
+            context.out.put(',');
+            context.RenderNumber(static_cast<int>(rgba.green));
+            context.out.put(',');
+            context.RenderNumber(static_cast<int>(rgba.blue));
+            context.out.put(',');
+            context.RenderNumber(rgba.opacity);
+            context.out.put(')');
+        }
+
+        // Выводит value / 10^decimals без незначащих нулей дробной части
+        void RenderFixed(std::ostream& out, int64_t value, int decimals) {
+            if (value < 0) {
+                out.put('-');
+                value = -value;
+            }
+            int64_t scale = 1;
+            for (int i = 0; i < decimals; ++i) {
+                scale *= 10;
+            }
+            char buffer[24];
+            auto result = std::to_chars(buffer, buffer + sizeof(buffer), value / scale);
+            out.write(buffer, result.ptr - buffer);
+
+            int64_t fraction = value % scale;
+            if (fraction == 0) return;
+            int digits = decimals;
+            while (fraction % 10 == 0) {
+                fraction /= 10;
+                --digits;
+            }
+            out.put('.');
+            result = std::to_chars(buffer, buffer + sizeof(buffer), fraction);
+            for (int i = static_cast<int>(result.ptr - buffer); i < digits; ++i) {
+                out.put('0');
+            }
+            out.write(buffer, result.ptr - buffer);
         }
 
     }  // namespace
 
     std::ostream& operator<<(std::ostream& out, const Color& color) {
-        std::visit(
-                [&out](const auto& value) {
-                    RenderColor(out, value);
-                },
-                color);
+        NumberFormatter numbers;
+        detail::RenderColor(RenderContext{out, numbers}, color);
         return out;
     }
 
@@ -81,7 +121,7 @@ namespace svg {
 
         RenderObject(context);
 
-        context.out << std::endl;
+        context.out.put('\n');
     }
 
 
@@ -97,9 +137,15 @@ namespace svg {
 
     void Circle::RenderObject(const RenderContext& context) const {
         auto& out = context.out;
-        out << "<circle cx=\""sv << center_.x << "\" cy=\""sv << center_.y << "\" "sv;
-        out << "r=\""sv << radius_ << "\" "sv;
-        RenderAttrs(out);
+        out << "<circle cx=\""sv;
+        context.RenderNumber(center_.x);
+        out << "\" cy=\""sv;
+        context.RenderNumber(center_.y);
+        out << "\" "sv;
+        out << "r=\""sv;
+        context.RenderNumber(radius_);
+        out << "\" "sv;
+        RenderAttrs(context);
         out << "/>"sv;
     }
 
@@ -109,6 +155,11 @@ namespace svg {
         return *this;
     }
 
+    Polyline& Polyline::ClearPoints() {
+        points_.clear();
+        return *this;
+    }
+
     void Polyline::RenderObject(const RenderContext& context) const {
         auto& out = context.out;
         out << "<polyline points=\""sv;
@@ -119,14 +170,79 @@ namespace svg {
             } else {
                 out << ' ';
             }
-            out << p.x << ',' << p.y;
+            context.RenderNumber(p.x);
+            out.put(',');
+            context.RenderNumber(p.y);
         }
         out << "\" "sv;
-        RenderAttrs(out);
+        RenderAttrs(context);
         out << "/>"sv;
     }
 
 
+    Path& Path::AddPoint(Point point) {
+        points_.push_back(point);
+        return *this;
+    }
+
+    Path& Path::ClearPoints() {
+        points_.clear();
+        return *this;
+    }
+
+    Path& Path::SetDecimals(int decimals) {
+        decimals_ = std::clamp(decimals, 0, MAX_DECIMALS);
+        return *this;
+    }
+
+    void Path::RenderObject(const RenderContext& context) const {
+        auto& out = context.out;
+        const double scale = std::pow(10.0, decimals_);
+        // Отрицательное число отделяется от предыдущего своим знаком, остальные - пробелом
+        auto render_number = [&out, this](int64_t value, bool separate) {
+            if (separate && value >= 0) {
+                out.put(' ');
+            }
+            RenderFixed(out, value, decimals_);
+        };
+        out << "<path d=\""sv;
+        int64_t x = 0;
+        int64_t y = 0;
+        for (size_t i = 0; i < points_.size(); ++i) {
+            const int64_t next_x = std::llround(points_[i].x * scale);
+            const int64_t next_y = std::llround(points_[i].y * scale);
+            if (i == 0) {
+                out.put('M');
+                render_number(next_x, false);
+                render_number(next_y, true);
+            } else {
+                if (i == 1) {
+                    out.put('l');
+                }
+                render_number(next_x - x, i > 1);
+                render_number(next_y - y, true);
+            }
+            x = next_x;
+            y = next_y;
+        }
+        out << "\" "sv;
+        RenderAttrs(context);
+        out << "/>"sv;
+    }
+
+
+    Style& Style::AddRule(std::string_view selector, std::string_view declarations) {
+        rules_.append(selector).append(1, '{').append(declarations).append(1, '}');
+        return *this;
+    }
+
+    void Style::RenderObject(const RenderContext& context) const {
+        context.out << "<style>"sv;
+        detail::HtmlEncodeString(context.out, rules_);
+        context.out << "</style>"sv;
+    }
+
+
     Text& Text::SetPosition(Point pos) {
         position_ = pos;
         return *this;
@@ -142,36 +258,36 @@ namespace svg {
         return *this;
     }
 
-    Text& Text::SetFontFamily(std::string font_family) {
-        font_family_ = std::move(font_family);
+    Text& Text::SetFontFamily(std::string_view font_family) {
+        font_family_.assign(font_family);
         return *this;
     }
 
-    Text& Text::SetFontWeight(std::string font_weight) {
-        font_weight_ = std::move(font_weight);
+    Text& Text::SetFontWeight(std::string_view font_weight) {
+        font_weight_.assign(font_weight);
         return *this;
     }
 
-    Text& Text::SetData(std::string data) {
-        data_ = std::move(data);
+    Text& Text::SetData(std::string_view data) {
+        data_.assign(data);
         return *this;
     }
 
     void Text::RenderObject(const RenderContext& context) const {
         auto& out = context.out;
         out << "<text "sv;
-        RenderAttrs(out);
+        RenderAttrs(context);
         using detail::RenderAttr;
-        RenderAttr(out, " x"sv, position_.x);
-        RenderAttr(out, " y"sv, position_.y);
-        RenderAttr(out, " dx"sv, offset_.x);
-        RenderAttr(out, " dy"sv, offset_.y);
-        RenderAttr(out, " font-size"sv, font_size_);
+        RenderAttr(context, " x"sv, position_.x);
+        RenderAttr(context, " y"sv, position_.y);
+        RenderAttr(context, " dx"sv, offset_.x);
+        RenderAttr(context, " dy"sv, offset_.y);
+        RenderAttr(context, " font-size"sv, font_size_);
         if (!font_family_.empty()) {
-            RenderAttr(out, " font-family"sv, font_family_);
+            RenderAttr(context, " font-family"sv, font_family_);
         }
         if (!font_weight_.empty()) {
-            RenderAttr(out, " font-weight"sv, font_weight_);
+            RenderAttr(context, " font-weight"sv, font_weight_);
         }
         out.put('>');
         detail::HtmlEncodeString(out, data_);
@@ -184,17 +300,130 @@ namespace svg {
     }
 
     void Document::Render(std::ostream& out) const {
-        out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>"sv << std::endl;
-        out << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">"sv << std::endl;
-        RenderContext ctx{out, 2, 2};
+        NumberFormatter numbers;
+        Render(out, numbers);
+    }
+
+    namespace {
+
+        constexpr std::string_view DOCUMENT_HEADER =
+            "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"
+            "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">\n"sv;
+
+    }  // namespace
+
+    void Document::Render(std::ostream& out, NumberFormatter& numbers) const {
+        OutputBuffer buffer(out);
+        std::ostream stream(&buffer);
+        stream << DOCUMENT_HEADER;
+        RenderContext ctx{stream, numbers, 2, 2};
         for (const auto& obj : objects_) {
             obj->Render(ctx);
         }
-        out << "</svg>"sv;
+        stream << "</svg>"sv;
+        buffer.Flush();
+    }
+
+    OutputBuffer::OutputBuffer(std::ostream& out, size_t capacity)
+            : out_(out)
+            , buffer_(std::max<size_t>(capacity, 1)) {
+        setp(buffer_.data(), buffer_.data() + buffer_.size());
+    }
+
+    OutputBuffer::~OutputBuffer() {
+        Flush();
+    }
+
+    void OutputBuffer::Flush() {
+        out_.write(pbase(), pptr() - pbase());
+        setp(buffer_.data(), buffer_.data() + buffer_.size());
+    }
+
+    OutputBuffer::int_type OutputBuffer::overflow(int_type c) {
+        Flush();
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize OutputBuffer::xsputn(const char* data, std::streamsize size) {
+        if (size <= epptr() - pptr()) {
+            std::copy_n(data, size, pptr());
+            pbump(static_cast<int>(size));
+        } else if (static_cast<size_t>(size) < buffer_.size()) {
+            Flush();
+            std::copy_n(data, size, pptr());
+            pbump(static_cast<int>(size));
+        } else {
+            // Блок больше буфера передаётся напрямую
+            Flush();
+            out_.write(data, size);
+        }
+        return size;
+    }
+
+    int OutputBuffer::sync() {
+        Flush();
+        return out_ ? 0 : -1;
+    }
+
+    StreamDocument::StreamDocument(std::ostream& out, NumberFormatter& numbers)
+            : buffer_(out)
+            , stream_(&buffer_)
+            , context_(stream_, numbers, 2, 2) {
+        stream_ << DOCUMENT_HEADER;
+    }
+
+    void StreamDocument::Add(const Object& object) {
+        if (finished_) {
+            throw std::logic_error("Add after Finish");
+        }
+        object.Render(context_);
+    }
+
+    void StreamDocument::AddPtr(std::unique_ptr<Object>&& obj) {
+        Add(*obj);
+    }
+
+    void StreamDocument::AddRendered(std::string_view fragment) {
+        if (finished_) {
+            throw std::logic_error("Add after Finish");
+        }
+        context_.out.write(fragment.data(), static_cast<std::streamsize>(fragment.size()));
+    }
+
+    void StreamDocument::Finish() {
+        if (!finished_) {
+            context_.out << "</svg>"sv;
+            buffer_.Flush();
+            finished_ = true;
+        }
+    }
+
+    StreamFragment::StreamFragment(std::ostream& out, NumberFormatter& numbers)
+            : context_(out, numbers, 2, 2) {
+    }
+
+    void StreamFragment::Add(const Object& object) {
+        object.Render(context_);
+    }
+
+    void StreamFragment::AddPtr(std::unique_ptr<Object>&& obj) {
+        Add(*obj);
     }
 
     namespace detail {
 
+        void RenderColor(const RenderContext& context, const Color& color) {
+            std::visit(
+                    [&context](const auto& value) {
+                        RenderColorValue(context, value);
+                    },
+                    color);
+        }
+
         void HtmlEncodeString(std::ostream& out, std::string_view sv) {
             for (char c : sv) {
                 switch (c) {
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "number_format.h"
+
+#include <algorithm>
 #include <cstdint>
 #include <iostream>
 #include <memory>
@@ -11,38 +14,6 @@
 
 namespace svg {
 
-    namespace detail {
-
-        template <typename T>
-        inline void RenderValue(std::ostream& out, const T& value) {
-            out << value;
-        }
-
-        void HtmlEncodeString(std::ostream& out, std::string_view sv);
-
-        template <>
-        inline void RenderValue<std::string>(std::ostream& out, const std::string& s) {
-            HtmlEncodeString(out, s);
-        }
-
-        template <typename AttrType>
-        inline void RenderAttr(std::ostream& out, std::string_view name, const AttrType& value) {
-            using namespace std::literals;
-            out << name << "=\""sv;
-            RenderValue(out, value);
-            out.put('"');
-        }
-
-        template <typename AttrType>
-        inline void RenderOptionalAttr(std::ostream& out, std::string_view name,
-                                       const std::optional<AttrType>& value) {
-            if (value) {
-                RenderAttr(out, name, *value);
-            }
-        }
-
-    }  // namespace detail
-
     struct Point {
         Point() = default;
         Point(double x, double y)
@@ -86,31 +57,91 @@ namespace svg {
     std::ostream& operator<<(std::ostream& out, const Color& color);
 
     struct RenderContext {
-        RenderContext(std::ostream& out)
-                : out(out) {
+        RenderContext(std::ostream& out, NumberFormatter& numbers)
+                : out(out)
+                , numbers(numbers) {
         }
 
-        RenderContext(std::ostream& out, int indent_step, int indent = 0)
+        RenderContext(std::ostream& out, NumberFormatter& numbers, int indent_step, int indent = 0)
                 : out(out)
+                , numbers(numbers)
                 , indent_step(indent_step)
                 , indent(indent) {
         }
 
         RenderContext Indented() const {
-            return {out, indent_step, indent + indent_step};
+            return {out, numbers, indent_step, indent + indent_step};
         }
 
         void RenderIndent() const {
-            for (int i = 0; i < indent; ++i) {
-                out.put(' ');
+            using namespace std::literals;
+            // Отступ выводится готовыми блоками пробелов, а не по символу
+            static constexpr std::string_view SPACES = "                                "sv;
+            for (int rest = indent; rest > 0; rest -= static_cast<int>(SPACES.size())) {
+                out.write(SPACES.data(), std::min<int>(rest, static_cast<int>(SPACES.size())));
             }
         }
 
+        // Числа выводятся через общий буфер, а не через форматирование потока
+        template <typename Number>
+        void RenderNumber(Number value) const {
+            numbers.Write(out, value);
+        }
+
         std::ostream& out;
+        NumberFormatter& numbers;
         int indent_step = 0;
         int indent = 0;
     };
 
+    namespace detail {
+
+        template <typename T>
+        inline void RenderValue(const RenderContext& context, const T& value) {
+            context.out << value;
+        }
+
+        void HtmlEncodeString(std::ostream& out, std::string_view sv);
+        void RenderColor(const RenderContext& context, const Color& color);
+
+        template <>
+        inline void RenderValue<std::string>(const RenderContext& context, const std::string& s) {
+            HtmlEncodeString(context.out, s);
+        }
+
+        template <>
+        inline void RenderValue<double>(const RenderContext& context, const double& value) {
+            context.RenderNumber(value);
+        }
+
+        template <>
+        inline void RenderValue<uint32_t>(const RenderContext& context, const uint32_t& value) {
+            context.RenderNumber(value);
+        }
+
+        template <>
+        inline void RenderValue<Color>(const RenderContext& context, const Color& color) {
+            RenderColor(context, color);
+        }
+
+        template <typename AttrType>
+        inline void RenderAttr(const RenderContext& context, std::string_view name, const AttrType& value) {
+            using namespace std::literals;
+            context.out << name << "=\""sv;
+            RenderValue(context, value);
+            context.out.put('"');
+        }
+
+        template <typename AttrType>
+        inline void RenderOptionalAttr(const RenderContext& context, std::string_view name,
+                                       const std::optional<AttrType>& value) {
+            if (value) {
+                RenderAttr(context, name, *value);
+            }
+        }
+
+    }  // namespace detail
+
     class Object {
     public:
         void Render(const RenderContext& context) const;
@@ -162,18 +193,28 @@ namespace svg {
             stroke_line_join_ = line_join;
             return AsOwner();
         }
+        // Классы стилей из элемента style; пустая строка - без атрибута class
+        Owner& SetClass(std::string_view class_name) {
+            class_name_.assign(class_name);
+            return AsOwner();
+        }
 
     protected:
         ~PathProps() = default;
 
-        void RenderAttrs(std::ostream& out) const {
+        void RenderAttrs(const RenderContext& context) const {
             using detail::RenderOptionalAttr;
             using namespace std::literals;
-            RenderOptionalAttr(out, "fill"sv, fill_color_);
-            RenderOptionalAttr(out, " stroke"sv, stroke_color_);
-            RenderOptionalAttr(out, " stroke-width"sv, stroke_width_);
-            RenderOptionalAttr(out, " stroke-linecap"sv, stroke_line_cap_);
-            RenderOptionalAttr(out, " stroke-linejoin"sv, stroke_line_join_);
+            if (!class_name_.empty()) {
+                detail::RenderAttr(context, "class"sv, class_name_);
+                RenderOptionalAttr(context, " fill"sv, fill_color_);
+            } else {
+                RenderOptionalAttr(context, "fill"sv, fill_color_);
+            }
+            RenderOptionalAttr(context, " stroke"sv, stroke_color_);
+            RenderOptionalAttr(context, " stroke-width"sv, stroke_width_);
+            RenderOptionalAttr(context, " stroke-linecap"sv, stroke_line_cap_);
+            RenderOptionalAttr(context, " stroke-linejoin"sv, stroke_line_join_);
         }
 
     private:
@@ -186,6 +227,7 @@ namespace svg {
         std::optional<double> stroke_width_;
         std::optional<StrokeLineCap> stroke_line_cap_;
         std::optional<StrokeLineJoin> stroke_line_join_;
+        std::string class_name_;
     };
 
     class Circle : public Object, public PathProps<Circle> {
@@ -203,12 +245,41 @@ namespace svg {
     class Polyline : public Object, public PathProps<Polyline> {
     public:
         Polyline& AddPoint(Point point);
+        // Удаляет точки, сохраняя выделенную под них память
+        Polyline& ClearPoints();
 
     private:
         void RenderObject(const RenderContext& context) const override;
         std::vector<Point> points_;
     };
 
+    // Ломаная в виде элемента path: первая точка - абсолютной командой M, остальные -
+    // относительной l. Координаты округляются до заданного числа знаков после запятой,
+    // смещения считаются между округлёнными точками, поэтому ошибка не накапливается
+    class Path : public Object, public PathProps<Path> {
+    public:
+        static constexpr int MAX_DECIMALS = 6;
+
+        Path& AddPoint(Point point);
+        Path& ClearPoints();
+        Path& SetDecimals(int decimals);
+
+    private:
+        void RenderObject(const RenderContext& context) const override;
+        std::vector<Point> points_;
+        int decimals_ = 2;
+    };
+
+    // Элемент style с правилами CSS вида "селектор{объявления}"
+    class Style : public Object {
+    public:
+        Style& AddRule(std::string_view selector, std::string_view declarations);
+
+    private:
+        void RenderObject(const RenderContext& context) const override;
+        std::string rules_;
+    };
+
     class Text : public Object, public PathProps<Text> {
     public:
         Text& SetPosition(Point pos);
@@ -217,11 +288,13 @@ namespace svg {
 
         Text& SetFontSize(uint32_t size);
 
-        Text& SetFontFamily(std::string font_family);
+        // Строки копируются в уже выделенную память объекта, поэтому повторно
+        // используемый Text не выделяет память для строк не длиннее прежних
+        Text& SetFontFamily(std::string_view font_family);
 
-        Text& SetFontWeight(std::string font_weight);
+        Text& SetFontWeight(std::string_view font_weight);
 
-        Text& SetData(std::string data);
+        Text& SetData(std::string_view data);
 
     private:
         void RenderObject(const RenderContext& context) const override;
@@ -258,9 +331,70 @@ namespace svg {
         void AddPtr(std::unique_ptr<Object>&& obj) override;
 
         void Render(std::ostream& out) const;
+        // Числа документа форматируются numbers
+        void Render(std::ostream& out, NumberFormatter& numbers) const;
 
     private:
         std::vector<std::unique_ptr<Object>> objects_;
     };
 
+    // Буфер вывода документа: текст копится в одном блоке памяти и передаётся в
+    // целевой поток целиком - при заполнении блока, в Flush и при уничтожении.
+    // Блок выделяется один раз и переиспользуется до конца вывода
+    class OutputBuffer : public std::streambuf {
+    public:
+        static constexpr size_t DEFAULT_CAPACITY = 1 << 16;
+
+        explicit OutputBuffer(std::ostream& out, size_t capacity = DEFAULT_CAPACITY);
+        ~OutputBuffer() override;
+
+        void Flush();
+
+    protected:
+        int_type overflow(int_type c) override;
+        std::streamsize xsputn(const char* data, std::streamsize size) override;
+        int sync() override;
+
+    private:
+        std::ostream& out_;
+        std::vector<char> buffer_;
+    };
+
+    // Документ, который выводит объекты сразу при добавлении, не сохраняя их.
+    // Add принимает объект по ссылке и не выделяет память; результат совпадает
+    // с Document::Render для той же последовательности объектов.
+    // Заголовок выводится в конструкторе, закрывающий тег - в Finish. Вывод идёт через
+    // OutputBuffer и попадает в out не позже Finish или уничтожения документа
+    class StreamDocument : public ObjectContainer {
+    public:
+        StreamDocument(std::ostream& out, NumberFormatter& numbers);
+
+        void Add(const Object& object);
+        void AddPtr(std::unique_ptr<Object>&& obj) override;
+        // Вставляет объекты, уже выведенные через StreamFragment
+        void AddRendered(std::string_view fragment);
+
+        void Finish();
+
+    private:
+        OutputBuffer buffer_;
+        std::ostream stream_;
+        RenderContext context_;
+        bool finished_ = false;
+    };
+
+    // Объекты тела документа без заголовка и закрывающего тега - с теми же
+    // отступами, что в StreamDocument. Позволяет выводить части документа
+    // независимо, например в разных потоках, и затем склеить их через AddRendered
+    class StreamFragment : public ObjectContainer {
+    public:
+        StreamFragment(std::ostream& out, NumberFormatter& numbers);
+
+        void Add(const Object& object);
+        void AddPtr(std::unique_ptr<Object>&& obj) override;
+
+    private:
+        RenderContext context_;
+    };
+
 }  // namespace svg
\ No newline at end of file
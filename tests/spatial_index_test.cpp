@@ -0,0 +1,134 @@
+// Проверка StopsSpatialIndex: ответы FindNearest и FindWithinRadius сравниваются
+// с полным перебором остановок на нескольких наборах - город, разреженные остановки
+// по всему миру, скопление вдали от запросов и остановки по обе стороны 180-го меридиана.
+//
+// Сборка и запуск из корня репозитория:
+//   g++ -std=c++17 -O2 -I. tests/spatial_index_test.cpp spatial_index.cpp transport_catalogue.cpp geo.cpp -o spatial_index_test
+//   ./spatial_index_test
+
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Area {
+    double min_lat;
+    double max_lat;
+    double min_lng;
+    double max_lng;
+};
+
+int failures = 0;
+
+void Check(bool condition, const std::string& what) {
+    if (!condition) {
+        ++failures;
+        std::cerr << "FAILED: " << what << '\n';
+    }
+}
+
+bool SameDistance(double lhs, double rhs) {
+    return std::abs(lhs - rhs) <= 1e-6 * std::max(1.0, std::max(lhs, rhs));
+}
+
+// Долготы за пределами [-180, 180] переносятся на другую сторону 180-го меридиана
+double NormalizeLng(double lng) {
+    return lng > 180.0 ? lng - 360.0 : lng < -180.0 ? lng + 360.0 : lng;
+}
+
+void AddStops(TransportCatalogue& catalogue, std::mt19937& random, const Area& area, int count) {
+    std::uniform_real_distribution<double> lat(area.min_lat, area.max_lat);
+    std::uniform_real_distribution<double> lng(area.min_lng, area.max_lng);
+    const size_t first = catalogue.GetAllStops().size();
+    for (int i = 0; i < count; ++i) {
+        Stop stop;
+        const std::string name = "S" + std::to_string(first + i);
+        stop.name = name;
+        stop.lat = lat(random);
+        stop.lng = NormalizeLng(lng(random));
+        catalogue.AddStop(stop);
+    }
+}
+
+std::vector<double> BruteForceDistances(const TransportCatalogue& catalogue, geo::Coordinates center) {
+    std::vector<double> distances;
+    for (const Stop& stop : catalogue.GetAllStops()) {
+        distances.push_back(geo::ComputeHaversineDistance(center, {stop.lat, stop.lng}));
+    }
+    std::sort(distances.begin(), distances.end());
+    return distances;
+}
+
+void CheckQuery(const TransportCatalogue& catalogue, const StopsSpatialIndex& index,
+                geo::Coordinates center, const std::string& label) {
+    const std::vector<double> expected = BruteForceDistances(catalogue, center);
+    const std::string where = label + " (" + std::to_string(center.lat) + ", " + std::to_string(center.lng) + ")";
+
+    for (size_t count : {1, 5, 20}) {
+        const auto nearest = index.FindNearest(center, count);
+        const size_t expected_size = std::min(count, expected.size());
+        Check(nearest.size() == expected_size, where + ": FindNearest size for count " + std::to_string(count));
+        for (size_t i = 0; i < std::min(nearest.size(), expected_size); ++i) {
+            Check(SameDistance(nearest[i].distance, expected[i]),
+                  where + ": FindNearest #" + std::to_string(i) + " is " + std::string(nearest[i].stop->name)
+                  + " at " + std::to_string(nearest[i].distance) + ", expected " + std::to_string(expected[i]));
+        }
+    }
+
+    // Радиусы берём от расстояния до ближайшей остановки, чтобы в круг что-то попадало
+    for (double factor : {0.5, 1.5, 4.0}) {
+        const double radius = expected.front() * factor + 100.0;
+        const auto within = index.FindWithinRadius(center, radius);
+        const size_t surely_inside = std::lower_bound(expected.begin(), expected.end(), radius * (1 - 1e-9)) - expected.begin();
+        const size_t maybe_inside = std::upper_bound(expected.begin(), expected.end(), radius * (1 + 1e-9)) - expected.begin();
+        Check(surely_inside <= within.size() && within.size() <= maybe_inside,
+              where + ": FindWithinRadius " + std::to_string(radius) + " returned " + std::to_string(within.size())
+              + ", expected " + std::to_string(surely_inside));
+        for (const NearbyStop& item : within) {
+            Check(item.distance <= radius, where + ": FindWithinRadius returned a stop outside the radius");
+        }
+    }
+}
+
+void RunCase(const std::string& label, const std::vector<std::pair<Area, int>>& stop_areas,
+             const Area& query_area, int query_count) {
+    std::mt19937 random(17);
+    TransportCatalogue catalogue;
+    for (const auto& [area, count] : stop_areas) {
+        AddStops(catalogue, random, area, count);
+    }
+    catalogue.Freeze();
+    const StopsSpatialIndex index(catalogue);
+
+    std::uniform_real_distribution<double> lat(query_area.min_lat, query_area.max_lat);
+    std::uniform_real_distribution<double> lng(query_area.min_lng, query_area.max_lng);
+    for (int i = 0; i < query_count; ++i) {
+        CheckQuery(catalogue, index, {lat(random), NormalizeLng(lng(random))}, label);
+    }
+}
+
+}  // namespace
+
+int main() {
+    RunCase("city", {{{55.5, 55.9, 37.3, 37.9}, 5000}}, {55.4, 56.0, 37.2, 38.0}, 200);
+    RunCase("world", {{{-70.0, 70.0, -180.0, 180.0}, 3000}}, {-80.0, 80.0, -180.0, 180.0}, 300);
+    RunCase("far cluster", {{{40.0, 70.0, 20.0, 60.0}, 3000}}, {50.0, 60.0, -180.0, -160.0}, 100);
+    RunCase("wide band", {{{40.0, 70.0, -120.0, 120.0}, 3000}}, {50.0, 60.0, -180.0, -160.0}, 100);
+    RunCase("two clusters", {{{55.5, 56.0, 37.0, 38.0}, 2000}, {{40.5, 41.0, -74.5, -73.5}, 2000}},
+            {-60.0, 60.0, -180.0, 180.0}, 200);
+    RunCase("antimeridian", {{{60.0, 66.0, 175.0, 185.0}, 3000}}, {58.0, 68.0, 170.0, 190.0}, 200);
+    RunCase("single stop", {{{10.0, 10.0, 20.0, 20.0}, 1}}, {-10.0, 30.0, 0.0, 40.0}, 20);
+
+    if (failures != 0) {
+        std::cerr << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "spatial_index_test: OK\n";
+    return 0;
+}
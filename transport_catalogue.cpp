@@ -1,15 +1,43 @@
 #include "transport_catalogue.h"
 #include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+namespace {
+
+// Общий для всех справочников счётчик версий
+uint64_t NextVersion() {
+    static std::atomic<uint64_t> counter{0};
+    return ++counter;
+}
+
+}  // namespace
+
+TransportCatalogue::TransportCatalogue() : version_(NextVersion()) {}
 
 void TransportCatalogue::AddStop(const Stop& stop) {
+    if (frozen_) throw std::logic_error("AddStop after Freeze");
+    version_ = NextVersion();
     stops_.push_back(stop);
-    const Stop* stop_ptr = &stops_.back();
+    Stop& stored = stops_.back();
+    stored.name = names_.Intern(stop.name);
+    stored.id = static_cast<uint32_t>(stops_.size() - 1);
+    stored.distances_begin = stored.distances_end = 0;
+    stop_points_.Add({stored.lat, stored.lng});
+    const Stop* stop_ptr = &stored;
     stopname_to_stop_[stop_ptr->name] = stop_ptr;
 }
 
 void TransportCatalogue::AddBus(const Bus& bus) {
+    if (frozen_) throw std::logic_error("AddBus after Freeze");
+    version_ = NextVersion();
     buses_.push_back(bus);
-    const Bus* bus_ptr = &buses_.back();
+    Bus& stored = buses_.back();
+    stored.name = names_.Intern(bus.name);
+    for (auto& stop_name : stored.stops) {
+        stop_name = names_.Intern(stop_name);
+    }
+    const Bus* bus_ptr = &stored;
     busname_to_bus_[bus_ptr->name] = bus_ptr;
     for (const auto& stop_name : bus_ptr->stops) {
         if (const Stop* stop = FindStop(stop_name)) {
@@ -19,12 +47,52 @@ void TransportCatalogue::AddBus(const Bus& bus) {
 }
 
 void TransportCatalogue::SetDistance(const Stop* from, const Stop* to, int distance) {
+    if (frozen_) throw std::logic_error("SetDistance after Freeze");
+    version_ = NextVersion();
     if (from && to) {
-        distances_[from][to] = distance;
+        pending_distances_.push_back({from->id, to->id, distance});
     }
 }
 
+void TransportCatalogue::Freeze() {
+    if (frozen_) return;
+
+    std::vector<FrozenNameIndex<Stop>::Entry> stop_entries(stopname_to_stop_.begin(), stopname_to_stop_.end());
+    frozen_stops_.Build(std::move(stop_entries));
+    std::vector<FrozenNameIndex<Bus>::Entry> bus_entries(busname_to_bus_.begin(), busname_to_bus_.end());
+    frozen_buses_.Build(std::move(bus_entries));
+
+    // Сортировка устойчивая, поэтому из повторных SetDistance для одной пары
+    // остаётся последнее значение, как и при записи в хеш-таблицу
+    std::stable_sort(pending_distances_.begin(), pending_distances_.end(),
+        [](const DistanceEntry& lhs, const DistanceEntry& rhs) {
+            return lhs.from < rhs.from || (lhs.from == rhs.from && lhs.to < rhs.to);
+        });
+    distances_.clear();
+    distances_.reserve(pending_distances_.size());
+    size_t i = 0;
+    for (Stop& stop : stops_) {
+        stop.distances_begin = static_cast<uint32_t>(distances_.size());
+        for (; i < pending_distances_.size() && pending_distances_[i].from == stop.id; ++i) {
+            const DistanceEntry& entry = pending_distances_[i];
+            if (distances_.size() > stop.distances_begin && distances_.back().to == entry.to) {
+                distances_.back().distance = entry.distance;
+            } else {
+                distances_.push_back({entry.to, entry.distance});
+            }
+        }
+        stop.distances_end = static_cast<uint32_t>(distances_.size());
+    }
+    std::vector<DistanceEntry>{}.swap(pending_distances_);
+
+    std::unordered_map<std::string_view, const Stop*>{}.swap(stopname_to_stop_);
+    std::unordered_map<std::string_view, const Bus*>{}.swap(busname_to_bus_);
+    names_.DropLookup();
+    frozen_ = true;
+}
+
 const Stop* TransportCatalogue::FindStop(std::string_view name) const {
+    if (frozen_) return frozen_stops_.Find(name);
     if (auto it = stopname_to_stop_.find(name); it != stopname_to_stop_.end()) {
         return it->second;
     }
@@ -32,6 +100,7 @@ const Stop* TransportCatalogue::FindStop(std::string_view name) const {
 }
 
 const Bus* TransportCatalogue::FindBus(std::string_view name) const {
+    if (frozen_) return frozen_buses_.Find(name);
     if (auto it = busname_to_bus_.find(name); it != busname_to_bus_.end()) {
         return it->second;
     }
@@ -50,10 +119,11 @@ std::vector<std::string_view> TransportCatalogue::GetBusesByStop(std::string_vie
 }
 
 int TransportCatalogue::GetRoadDistance(const Stop* from, const Stop* to) const {
+    if (!frozen_) throw std::logic_error("GetRoadDistance before Freeze");
     if (!from || !to) return 0;
-    if (auto it = distances_.find(from); it != distances_.end()) {
-        if (auto jt = it->second.find(to); jt != it->second.end()) {
-            return jt->second;
+    for (uint32_t i = from->distances_begin; i < from->distances_end; ++i) {
+        if (distances_[i].to == to->id) {
+            return distances_[i].distance;
         }
     }
     return 0;
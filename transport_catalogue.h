@@ -1,34 +1,71 @@
 #pragma once
 #include "domain.h"
+#include "geo.h"
+#include "name_index.h"
+#include "string_arena.h"
 #include <deque>
 #include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 #include <optional>
+#include <cstdint>
 
 class TransportCatalogue {
 public:
+    TransportCatalogue();
+
     void AddStop(const Stop& stop);
     void AddBus(const Bus& bus);
     void SetDistance(const Stop* from, const Stop* to, int distance);
 
+    // Завершает загрузку: строит неизменяемые индексы имён и освобождает
+    // хеш-таблицы, нужные только на этапе наполнения справочника
+    void Freeze();
+    bool IsFrozen() const { return frozen_; }
+    // Меняется при каждом изменении данных и не повторяется у разных справочников,
+    // поэтому подходит как ключ для кешей производных данных
+    uint64_t GetVersion() const { return version_; }
+
     const Stop* FindStop(std::string_view name) const;
     const Bus* FindBus(std::string_view name) const;
 
     std::vector<std::string_view> GetBusesByStop(std::string_view stop_name) const;
 
+    // Расстояния упорядочиваются в Freeze, поэтому до него запрос бросает std::logic_error
     int GetRoadDistance(const Stop* from, const Stop* to) const;
     int GetRoadDistanceBidirectional(const Stop* from, const Stop* to) const;
 
     const std::deque<Stop>& GetAllStops() const { return stops_; }
     const std::deque<Bus>& GetAllBuses() const { return buses_; }
+    // Предвычисленные координаты остановок; индекс совпадает с Stop::id
+    const geo::PrecomputedPoints& GetStopPoints() const { return stop_points_; }
 
 private:
+    StringArena names_;
     std::deque<Stop> stops_;
+    geo::PrecomputedPoints stop_points_;
     std::deque<Bus> buses_;
     std::unordered_map<std::string_view, const Stop*> stopname_to_stop_;
     std::unordered_map<std::string_view, const Bus*> busname_to_bus_;
-    std::unordered_map<const Stop*, std::unordered_map<const Stop*, int>> distances_;
+    FrozenNameIndex<Stop> frozen_stops_;
+    FrozenNameIndex<Bus> frozen_buses_;
+    bool frozen_ = false;
+    uint64_t version_ = 0;
+
+    // Дорожные расстояния. На этапе загрузки копятся в pending_distances_,
+    // в Freeze упорядочиваются по остановке отправления в плотный массив
+    struct DistanceEntry {
+        uint32_t from;
+        uint32_t to;
+        int distance;
+    };
+    struct AdjacentStop {
+        uint32_t to;
+        int distance;
+    };
+    std::vector<DistanceEntry> pending_distances_;
+    std::vector<AdjacentStop> distances_;
+
     std::unordered_map<const Stop*, std::unordered_set<std::string_view>> stop_to_buses_;
 };
\ No newline at end of file
@@ -46,8 +46,8 @@ void TransportRouter::AddEdgesForBus(const Bus& bus) {
     
     for (size_t i = 0; i < bus.stops.size(); ++i) {
         for (size_t j = i + 1; j < bus.stops.size(); ++j) {
-            const std::string& from_stop = bus.stops[i];
-            const std::string& to_stop = bus.stops[j];
+            std::string_view from_stop = bus.stops[i];
+            std::string_view to_stop = bus.stops[j];
             
             auto from_bus_vertex_it = stop_to_bus_vertex_.find(from_stop);
             auto to_wait_vertex_it = stop_to_wait_vertex_.find(to_stop);
@@ -64,8 +64,8 @@ void TransportRouter::AddEdgesForBus(const Bus& bus) {
             int total_distance = 0;
             
             for (size_t k = i; k < j; ++k) {
-                const std::string& current_stop = bus.stops[k];
-                const std::string& next_stop = bus.stops[k + 1];
+                std::string_view current_stop = bus.stops[k];
+                std::string_view next_stop = bus.stops[k + 1];
                 
                 const Stop* current_stop_ptr = catalogue_.FindStop(current_stop);
                 const Stop* next_stop_ptr = catalogue_.FindStop(next_stop);
@@ -90,15 +90,15 @@ void TransportRouter::AddEdgesForBus(const Bus& bus) {
             graph::EdgeId edge_id = graph_->AddEdge(edge);
             
             edge_to_bus_[edge_id] = bus.name;
-            edge_to_span_count_[edge_id] = static_cast<int>(j - i);
+            edge_to_span_[edge_id] = {static_cast<int>(j - i), static_cast<uint32_t>(i), false};
         }
     }
     
     if (!bus.is_roundtrip) {
         for (size_t i = bus.stops.size() - 1; i > 0; --i) {
             for (size_t j = i - 1; j < bus.stops.size(); --j) {
-                const std::string& from_stop = bus.stops[i];
-                const std::string& to_stop = bus.stops[j];
+                std::string_view from_stop = bus.stops[i];
+                std::string_view to_stop = bus.stops[j];
                 
                 auto from_bus_vertex_it = stop_to_bus_vertex_.find(from_stop);
                 auto to_wait_vertex_it = stop_to_wait_vertex_.find(to_stop);
@@ -115,8 +115,8 @@ void TransportRouter::AddEdgesForBus(const Bus& bus) {
                 int total_distance = 0;
                 
                 for (size_t k = i; k > j; --k) {
-                    const std::string& current_stop = bus.stops[k];
-                    const std::string& next_stop = bus.stops[k - 1];
+                    std::string_view current_stop = bus.stops[k];
+                    std::string_view next_stop = bus.stops[k - 1];
                     
                     const Stop* current_stop_ptr = catalogue_.FindStop(current_stop);
                     const Stop* next_stop_ptr = catalogue_.FindStop(next_stop);
@@ -141,7 +141,7 @@ void TransportRouter::AddEdgesForBus(const Bus& bus) {
                 graph::EdgeId edge_id = graph_->AddEdge(edge);
                 
                 edge_to_bus_[edge_id] = bus.name;
-                edge_to_span_count_[edge_id] = static_cast<int>(i - j);
+                edge_to_span_[edge_id] = {static_cast<int>(i - j), static_cast<uint32_t>(i), true};
             }
         }
     }
@@ -153,7 +153,7 @@ double TransportRouter::CalculateTime(int distance) const {
     return distance / velocity_m_per_min;
 }
 
-std::optional<RouteInfo> TransportRouter::BuildRoute(const std::string& from, const std::string& to) const {
+std::optional<RouteInfo> TransportRouter::BuildRoute(std::string_view from, std::string_view to) const {
     const_cast<TransportRouter*>(this)->BuildGraph();
     
     auto from_wait_vertex_it = stop_to_wait_vertex_.find(from);
@@ -195,14 +195,16 @@ std::optional<RouteInfo> TransportRouter::ReconstructRoute(graph::VertexId from,
             result.items.push_back(wait_item);
         } else {
             auto bus_it = edge_to_bus_.find(edge_id);
-            auto span_count_it = edge_to_span_count_.find(edge_id);
+            auto span_it = edge_to_span_.find(edge_id);
             
-            if (bus_it != edge_to_bus_.end() && span_count_it != edge_to_span_count_.end()) {
+            if (bus_it != edge_to_bus_.end() && span_it != edge_to_span_.end()) {
                 RouteItem bus_item;
                 bus_item.type = RouteItem::Type::Bus;
                 bus_item.bus = bus_it->second;
-                bus_item.span_count = span_count_it->second;
+                bus_item.span_count = span_it->second.span_count;
                 bus_item.time = edge.weight;
+                bus_item.first_stop_index = span_it->second.first_stop_index;
+                bus_item.backward = span_it->second.backward;
                 result.items.push_back(bus_item);
             }
         }
@@ -3,7 +3,9 @@
 #include "transport_catalogue.h"
 #include "graph.h"
 #include "router.h"
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <optional>
 #include <unordered_map>
@@ -21,10 +23,14 @@ struct RouteItem {
     };
     
     Type type;
-    std::string stop_name;
-    std::string bus;
+    std::string_view stop_name;
+    std::string_view bus;
     int span_count;
     double time;
+    // Для поездки: номер остановки посадки в списке остановок автобуса и
+    // направление - обратное для пути назад по некольцевому маршруту
+    size_t first_stop_index = 0;
+    bool backward = false;
 };
 
 struct RouteInfo {
@@ -37,7 +43,7 @@ public:
     explicit TransportRouter(const TransportCatalogue& catalogue);
     
     void SetRoutingSettings(const RoutingSettings& settings);
-    std::optional<RouteInfo> BuildRoute(const std::string& from, const std::string& to) const;
+    std::optional<RouteInfo> BuildRoute(std::string_view from, std::string_view to) const;
 
 private:
     void BuildGraph();
@@ -55,13 +61,19 @@ private:
     // Для каждой остановки у нас есть две вершины:
     // - wait_vertex: вершина "ожидание на остановке"
     // - bus_vertex: вершина "посадка в автобус на остановке"
-    std::unordered_map<std::string, graph::VertexId> stop_to_wait_vertex_;
-    std::unordered_map<std::string, graph::VertexId> stop_to_bus_vertex_;
-    std::unordered_map<graph::VertexId, std::string> vertex_to_stop_;
+    // Строки принадлежат пулу имён справочника
+    std::unordered_map<std::string_view, graph::VertexId> stop_to_wait_vertex_;
+    std::unordered_map<std::string_view, graph::VertexId> stop_to_bus_vertex_;
+    std::unordered_map<graph::VertexId, std::string_view> vertex_to_stop_;
     
     // Информация о ребрах
-    std::unordered_map<graph::EdgeId, std::string> edge_to_bus_;
-    std::unordered_map<graph::EdgeId, int> edge_to_span_count_;
+    std::unordered_map<graph::EdgeId, std::string_view> edge_to_bus_;
+    struct BusSpan {
+        int span_count;
+        uint32_t first_stop_index;
+        bool backward;
+    };
+    std::unordered_map<graph::EdgeId, BusSpan> edge_to_span_;
     
     bool graph_built_ = false;
 };
\ No newline at end of file